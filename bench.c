@@ -0,0 +1,298 @@
+/* Offline GPU benchmark: renders scripted camera paths over the default
+   scene with a headless renderer at several resolutions, with time_s and
+   every camera fixed per frame, and reports ms/frame, primary rays/s and
+   march steps per ray as a table, CSV and JSON. Built and run by
+   `make bench`. */
+
+#include "gl_renderer.h"
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <math.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FRAMES 120
+#define MAX_SIZES 8
+#define MAX_RUNS 64
+
+/* A camera path: the camera at t in [0, 1] */
+typedef struct {
+    const char *name;
+    void (*camera_at)(float t, camera_t *cam);
+} camera_path;
+
+/* Once around the pieces at head height, looking at them */
+static void orbit_camera(float t, camera_t *cam)
+{
+    float a = t * 6.2831853f;
+    cam->pos[0] = 5.0f * sinf(a);
+    cam->pos[1] = 1.0f;
+    cam->pos[2] = -4.0f + 5.0f * cosf(a);
+    const float pieces[3] = { 0.0f, -0.5f, -4.0f };
+    camera_look_at(cam, pieces);
+}
+
+/* From behind the default camera over the pieces and beyond, weaving
+   slightly and looking ahead and down */
+static void flythrough_camera(float t, camera_t *cam)
+{
+    cam->pos[0] = 0.8f * sinf(t * 9.424778f);
+    cam->pos[1] = 0.6f - 0.3f * t;
+    cam->pos[2] = 6.0f - 18.0f * t;
+    cam->yaw = 0.25f * cosf(t * 9.424778f);
+    cam->pitch = -0.2f;
+}
+
+/* Just above the board, looking level along it and panning: nearly every
+   ray below the horizon grazes the floor */
+static void grazing_camera(float t, camera_t *cam)
+{
+    cam->pos[0] = -2.0f + 4.0f * t;
+    cam->pos[1] = -0.9f;
+    cam->pos[2] = 2.0f;
+    cam->yaw = -0.6f + 1.2f * t;
+    cam->pitch = 0.0f;
+}
+
+static const camera_path paths[] = {
+    { "orbit", orbit_camera },
+    { "flythrough", flythrough_camera },
+    { "grazing", grazing_camera },
+};
+#define PATH_COUNT ((int)(sizeof(paths) / sizeof(paths[0])))
+
+typedef struct {
+    const char *path;
+    int width;
+    int height;
+    int frames;
+    double ms_avg;          /* wall clock per frame, GPU finished */
+    double ms_p99;
+    double mrays_per_s;     /* primary rays */
+    /* From gl_renderer_get_stats, so over the last 128 frames at most */
+    float steps_per_ray;
+    float edge_steps_per_ray;   /* edge anti-aliasing re-sample rays, apart from steps_per_ray */
+    float gpu_compute_ms;   /* avg from timestamp queries; 0 without them */
+} bench_result;
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Render frames of path at width x height on a fresh renderer, so no
+   history or statistics carry over from another run. Frame i is drawn at
+   time_s = i / 60 with the camera at i / (frames - 1) along the path. */
+static bool run_path(const camera_path *path, int width, int height, int frames, char *device, size_t device_size,
+                     bench_result *out)
+{
+    gl_renderer *renderer = gl_renderer_create_headless(width, height);
+    if (!renderer || !gl_renderer_ok(renderer))
+    {
+        fprintf(stderr, "Error: Failed to create headless OpenGL renderer\n");
+        if (renderer)
+            gl_renderer_destroy(renderer);
+        return false;
+    }
+    const char *name = (const char *)glGetString(GL_RENDERER);
+    if (!device[0])
+        snprintf(device, device_size, "%s", name ? name : "unknown");
+
+    double *ms = malloc(sizeof(double) * (size_t)frames);
+    if (!ms)
+    {
+        gl_renderer_destroy(renderer);
+        return false;
+    }
+
+    /* Warm-up frame at the path's start absorbs shader JIT and first-use
+       allocation */
+    camera_t cam = { 0 };
+    path->camera_at(0.0f, &cam);
+    gl_renderer_draw(renderer, 0.0f, &cam);
+    gl_renderer_finish(renderer);
+
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    double total = 0.0;
+    for (int i = 0; i < frames; i++)
+    {
+        path->camera_at(frames > 1 ? (float)i / (float)(frames - 1) : 0.0f, &cam);
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        gl_renderer_draw(renderer, (float)i / 60.0f, &cam);
+        gl_renderer_finish(renderer);
+        ms[i] = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / (double)freq;
+        total += ms[i];
+    }
+
+    qsort(ms, (size_t)frames, sizeof(double), compare_double);
+    int p99 = (int)ceil(0.99 * frames) - 1;
+    gl_renderer_stats stats;
+    gl_renderer_get_stats(renderer, &stats);
+
+    out->path = path->name;
+    out->width = width;
+    out->height = height;
+    out->frames = frames;
+    out->ms_avg = total / frames;
+    out->ms_p99 = ms[p99 < 0 ? 0 : p99];
+    out->mrays_per_s = (double)width * height * frames / (total / 1000.0) / 1e6;
+    out->steps_per_ray = stats.steps_per_pixel;
+    out->edge_steps_per_ray = stats.edge_steps_per_pixel;
+    out->gpu_compute_ms = stats.compute.avg_ms;
+
+    free(ms);
+    gl_renderer_destroy(renderer);
+    return true;
+}
+
+static bool write_csv(const char *file, const bench_result *results, int count)
+{
+    FILE *f = fopen(file, "w");
+    if (!f)
+    {
+        fprintf(stderr, "Error: cannot write %s\n", file);
+        return false;
+    }
+    fprintf(f, "path,width,height,frames,ms_per_frame,ms_p99,gpu_compute_ms,mrays_per_s,steps_per_ray,edge_steps_per_ray\n");
+    for (int i = 0; i < count; i++)
+    {
+        const bench_result *r = &results[i];
+        fprintf(f, "%s,%d,%d,%d,%.4f,%.4f,%.4f,%.3f,%.2f,%.2f\n", r->path, r->width, r->height, r->frames, r->ms_avg,
+                r->ms_p99, r->gpu_compute_ms, r->mrays_per_s, r->steps_per_ray, r->edge_steps_per_ray);
+    }
+    return fclose(f) == 0;
+}
+
+/* s as a JSON string body: quotes, backslashes and control characters escaped */
+static void write_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", *s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static bool write_json(const char *file, const char *device, const bench_result *results, int count)
+{
+    FILE *f = fopen(file, "w");
+    if (!f)
+    {
+        fprintf(stderr, "Error: cannot write %s\n", file);
+        return false;
+    }
+    fprintf(f, "{\n  \"device\": ");
+    write_json_string(f, device);
+    fprintf(f, ",\n  \"runs\": [\n");
+    for (int i = 0; i < count; i++)
+    {
+        const bench_result *r = &results[i];
+        fprintf(f, "    {\"path\": \"%s\", \"width\": %d, \"height\": %d, \"frames\": %d, \"ms_per_frame\": %.4f,"
+                   " \"ms_p99\": %.4f, \"gpu_compute_ms\": %.4f, \"mrays_per_s\": %.3f, \"steps_per_ray\": %.2f,"
+                   " \"edge_steps_per_ray\": %.2f}%s\n",
+                r->path, r->width, r->height, r->frames, r->ms_avg, r->ms_p99, r->gpu_compute_ms, r->mrays_per_s,
+                r->steps_per_ray, r->edge_steps_per_ray, i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+/* "WxH,WxH,..." into sizes; returns the count, 0 if malformed */
+static int parse_sizes(const char *arg, int sizes[][2])
+{
+    int count = 0;
+    while (*arg && count < MAX_SIZES)
+    {
+        int w, h, n;
+        if (sscanf(arg, "%dx%d%n", &w, &h, &n) != 2 || w < 1 || h < 1)
+            return 0;
+        sizes[count][0] = w;
+        sizes[count][1] = h;
+        count++;
+        arg += n;
+        if (*arg == ',')
+            arg++;
+        else if (*arg)
+            return 0;
+    }
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    int sizes[MAX_SIZES][2] = { { 320, 180 }, { 640, 360 }, { 1280, 720 } };
+    int size_count = 3;
+    int frames = DEFAULT_FRAMES;
+    const char *only_path = NULL;
+    const char *csv_file = NULL;
+    const char *json_file = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc && (size_count = parse_sizes(argv[i + 1], sizes)) > 0)
+            i++;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+            only_path = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csv_file = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json_file = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--sizes WxH,WxH,...] [--frames N] [--path orbit|flythrough|grazing]"
+                            " [--csv FILE] [--json FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1)
+        frames = 1;
+
+    bench_result results[MAX_RUNS];
+    int count = 0;
+    char device[256] = "";
+
+    printf("%-11s %10s %7s %10s %10s %10s %10s %10s %10s\n", "path", "size", "frames", "ms/frame", "p99 ms",
+           "GPU ms", "Mrays/s", "steps/ray", "edge steps");
+    for (int s = 0; s < size_count; s++)
+    {
+        for (int p = 0; p < PATH_COUNT && count < MAX_RUNS; p++)
+        {
+            if (only_path && strcmp(only_path, paths[p].name) != 0)
+                continue;
+            bench_result *r = &results[count];
+            if (!run_path(&paths[p], sizes[s][0], sizes[s][1], frames, device, sizeof(device), r))
+                return 1;
+            count++;
+
+            char size[32];
+            snprintf(size, sizeof(size), "%dx%d", r->width, r->height);
+            printf("%-11s %10s %7d %10.3f %10.3f %10.3f %10.2f %10.2f %10.2f\n", r->path, size, r->frames, r->ms_avg,
+                   r->ms_p99, r->gpu_compute_ms, r->mrays_per_s, r->steps_per_ray, r->edge_steps_per_ray);
+        }
+    }
+    if (count == 0)
+    {
+        fprintf(stderr, "Error: no camera path named %s\n", only_path);
+        return 1;
+    }
+    printf("Device: %s\n", device);
+
+    if (csv_file && !write_csv(csv_file, results, count))
+        return 1;
+    if (json_file && !write_json(json_file, device, results, count))
+        return 1;
+    return 0;
+}
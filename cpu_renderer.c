@@ -0,0 +1,674 @@
+#include "cpu_renderer.h"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---- SIMD lane abstraction ----
+   vf holds VF_WIDTH floats, one per ray. Comparisons return lane masks
+   (all bits set where true) that feed vf_select / vf_any. */
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VF_WIDTH 8
+typedef __m256 vf;
+static inline vf vf_set1(float a) { return _mm256_set1_ps(a); }
+static inline vf vf_load(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vf_store(float *p, vf a) { _mm256_storeu_ps(p, a); }
+static inline vf vf_add(vf a, vf b) { return _mm256_add_ps(a, b); }
+static inline vf vf_sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+static inline vf vf_mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+static inline vf vf_div(vf a, vf b) { return _mm256_div_ps(a, b); }
+static inline vf vf_min(vf a, vf b) { return _mm256_min_ps(a, b); }
+static inline vf vf_max(vf a, vf b) { return _mm256_max_ps(a, b); }
+static inline vf vf_sqrt(vf a) { return _mm256_sqrt_ps(a); }
+static inline vf vf_abs(vf a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline vf vf_lt(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline vf vf_and(vf a, vf b) { return _mm256_and_ps(a, b); }
+static inline vf vf_or(vf a, vf b) { return _mm256_or_ps(a, b); }
+static inline vf vf_andnot(vf m, vf a) { return _mm256_andnot_ps(m, a); }
+static inline vf vf_select(vf m, vf a, vf b) { return _mm256_blendv_ps(b, a, m); }
+static inline vf vf_true(void) { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+static inline bool vf_any(vf m) { return _mm256_movemask_ps(m) != 0; }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VF_WIDTH 4
+typedef __m128 vf;
+static inline vf vf_set1(float a) { return _mm_set1_ps(a); }
+static inline vf vf_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void vf_store(float *p, vf a) { _mm_storeu_ps(p, a); }
+static inline vf vf_add(vf a, vf b) { return _mm_add_ps(a, b); }
+static inline vf vf_sub(vf a, vf b) { return _mm_sub_ps(a, b); }
+static inline vf vf_mul(vf a, vf b) { return _mm_mul_ps(a, b); }
+static inline vf vf_div(vf a, vf b) { return _mm_div_ps(a, b); }
+static inline vf vf_min(vf a, vf b) { return _mm_min_ps(a, b); }
+static inline vf vf_max(vf a, vf b) { return _mm_max_ps(a, b); }
+static inline vf vf_sqrt(vf a) { return _mm_sqrt_ps(a); }
+static inline vf vf_abs(vf a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline vf vf_lt(vf a, vf b) { return _mm_cmplt_ps(a, b); }
+static inline vf vf_and(vf a, vf b) { return _mm_and_ps(a, b); }
+static inline vf vf_or(vf a, vf b) { return _mm_or_ps(a, b); }
+static inline vf vf_andnot(vf m, vf a) { return _mm_andnot_ps(m, a); }
+static inline vf vf_select(vf m, vf a, vf b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline vf vf_true(void) { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+static inline bool vf_any(vf m) { return _mm_movemask_ps(m) != 0; }
+#else
+/* Scalar fallback: one ray per packet, masks carried as float bit patterns */
+#define VF_WIDTH 1
+typedef float vf;
+static inline uint32_t vf_bits(vf a) { uint32_t u; memcpy(&u, &a, 4); return u; }
+static inline vf vf_from_bits(uint32_t u) { vf a; memcpy(&a, &u, 4); return a; }
+static inline vf vf_set1(float a) { return a; }
+static inline vf vf_load(const float *p) { return *p; }
+static inline void vf_store(float *p, vf a) { *p = a; }
+static inline vf vf_add(vf a, vf b) { return a + b; }
+static inline vf vf_sub(vf a, vf b) { return a - b; }
+static inline vf vf_mul(vf a, vf b) { return a * b; }
+static inline vf vf_div(vf a, vf b) { return a / b; }
+static inline vf vf_min(vf a, vf b) { return a < b ? a : b; }
+static inline vf vf_max(vf a, vf b) { return a > b ? a : b; }
+static inline vf vf_sqrt(vf a) { return sqrtf(a); }
+static inline vf vf_abs(vf a) { return fabsf(a); }
+static inline vf vf_lt(vf a, vf b) { return vf_from_bits(a < b ? 0xffffffffu : 0u); }
+static inline vf vf_and(vf a, vf b) { return vf_from_bits(vf_bits(a) & vf_bits(b)); }
+static inline vf vf_or(vf a, vf b) { return vf_from_bits(vf_bits(a) | vf_bits(b)); }
+static inline vf vf_andnot(vf m, vf a) { return vf_from_bits(~vf_bits(m) & vf_bits(a)); }
+static inline vf vf_select(vf m, vf a, vf b) { return vf_bits(m) ? a : b; }
+static inline vf vf_true(void) { return vf_from_bits(0xffffffffu); }
+static inline bool vf_any(vf m) { return vf_bits(m) != 0; }
+#endif
+
+static inline vf vf_clamp(vf a, float lo, float hi) { return vf_min(vf_max(a, vf_set1(lo)), vf_set1(hi)); }
+
+typedef struct {
+    vf x, y, z;
+} vf3;
+
+static inline vf3 v3_set(float x, float y, float z) { return (vf3){ vf_set1(x), vf_set1(y), vf_set1(z) }; }
+static inline vf3 v3_add(vf3 a, vf3 b) { return (vf3){ vf_add(a.x, b.x), vf_add(a.y, b.y), vf_add(a.z, b.z) }; }
+static inline vf3 v3_sub(vf3 a, vf3 b) { return (vf3){ vf_sub(a.x, b.x), vf_sub(a.y, b.y), vf_sub(a.z, b.z) }; }
+static inline vf3 v3_scale(vf3 a, vf s) { return (vf3){ vf_mul(a.x, s), vf_mul(a.y, s), vf_mul(a.z, s) }; }
+static inline vf v3_dot(vf3 a, vf3 b) { return vf_add(vf_add(vf_mul(a.x, b.x), vf_mul(a.y, b.y)), vf_mul(a.z, b.z)); }
+static inline vf v3_length(vf3 a) { return vf_sqrt(v3_dot(a, a)); }
+static inline vf3 v3_normalize(vf3 a) { return v3_scale(a, vf_div(vf_set1(1.0f), v3_length(a))); }
+static inline vf3 v3_select(vf m, vf3 a, vf3 b)
+{
+    return (vf3){ vf_select(m, a.x, b.x), vf_select(m, a.y, b.y), vf_select(m, a.z, b.z) };
+}
+static inline vf3 v3_offset(vf3 p, float x, float y, float z)
+{
+    return (vf3){ vf_sub(p.x, vf_set1(x)), vf_sub(p.y, vf_set1(y)), vf_sub(p.z, vf_set1(z)) };
+}
+
+/* ---- SDF primitives, mirroring shaders/raymarch.comp ---- */
+
+static inline vf sdf_sphere(vf3 p, float radius)
+{
+    return vf_sub(v3_length(p), vf_set1(radius));
+}
+
+static inline vf sdf_box(vf3 p, float bx, float by, float bz)
+{
+    vf qx = vf_sub(vf_abs(p.x), vf_set1(bx));
+    vf qy = vf_sub(vf_abs(p.y), vf_set1(by));
+    vf qz = vf_sub(vf_abs(p.z), vf_set1(bz));
+    vf zero = vf_set1(0.0f);
+    vf3 o = { vf_max(qx, zero), vf_max(qy, zero), vf_max(qz, zero) };
+    vf inside = vf_min(vf_max(qx, vf_max(qy, qz)), zero);
+    return vf_add(v3_length(o), inside);
+}
+
+static inline vf sdf_capped_cone(vf3 p, float h, float r1, float r2)
+{
+    vf qx = vf_sqrt(vf_add(vf_mul(p.x, p.x), vf_mul(p.z, p.z)));
+    vf qy = p.y;
+    float k2x = r2 - r1, k2y = 2.0f * h;
+    float inv_k2 = 1.0f / (k2x * k2x + k2y * k2y);
+    vf zero = vf_set1(0.0f);
+
+    vf r = vf_select(vf_lt(qy, zero), vf_set1(r1), vf_set1(r2));
+    vf cax = vf_sub(qx, vf_min(qx, r));
+    vf cay = vf_sub(vf_abs(qy), vf_set1(h));
+
+    vf t = vf_add(vf_mul(vf_sub(vf_set1(r2), qx), vf_set1(k2x)),
+                  vf_mul(vf_sub(vf_set1(h), qy), vf_set1(k2y)));
+    t = vf_clamp(vf_mul(t, vf_set1(inv_k2)), 0.0f, 1.0f);
+    vf cbx = vf_add(vf_sub(qx, vf_set1(r2)), vf_mul(vf_set1(k2x), t));
+    vf cby = vf_add(vf_sub(qy, vf_set1(h)), vf_mul(vf_set1(k2y), t));
+
+    vf inside = vf_and(vf_lt(cbx, zero), vf_lt(cay, zero));
+    vf s = vf_select(inside, vf_set1(-1.0f), vf_set1(1.0f));
+    vf da = vf_add(vf_mul(cax, cax), vf_mul(cay, cay));
+    vf db = vf_add(vf_mul(cbx, cbx), vf_mul(cby, cby));
+    return vf_mul(s, vf_sqrt(vf_min(da, db)));
+}
+
+static inline vf sdf_torus(vf3 p, float major, float minor)
+{
+    vf qx = vf_sub(vf_sqrt(vf_add(vf_mul(p.x, p.x), vf_mul(p.z, p.z))), vf_set1(major));
+    return vf_sub(vf_sqrt(vf_add(vf_mul(qx, qx), vf_mul(p.y, p.y))), vf_set1(minor));
+}
+
+/* ---- SDF operations ----
+   Every primitive inside a piece shares the piece colour, so the colour
+   blend in the shader's SDFHit ops is the identity there; only distances
+   are combined here and colour is resolved at the scene-level union. */
+
+static inline vf op_smooth_union(vf a, vf b, float k)
+{
+    k *= 4.0f;
+    vf h = vf_max(vf_sub(vf_set1(k), vf_abs(vf_sub(a, b))), vf_set1(0.0f));
+    return vf_sub(vf_min(a, b), vf_mul(vf_mul(h, h), vf_set1(0.25f / k)));
+}
+
+static inline vf op_smooth_subtraction(vf a, vf b, float k)
+{
+    vf zero = vf_set1(0.0f);
+    return vf_sub(zero, op_smooth_union(vf_sub(zero, a), b, k));
+}
+
+/* cos/sin of the rook crenellation angles i * PI / 3 */
+static float crown_cos[6], crown_sin[6];
+
+static void init_crown_table(void)
+{
+    const float PI = 3.14159265f;
+    for (int i = 0; i < 6; i++) {
+        crown_cos[i] = cosf((float)i * PI / 3.0f);
+        crown_sin[i] = sinf((float)i * PI / 3.0f);
+    }
+}
+
+static inline vf sdf_pawn(vf3 pos)
+{
+    vf base = sdf_capped_cone(pos, 0.1f, 0.5f, 0.5f);
+    vf base2 = sdf_capped_cone(v3_offset(pos, 0.0f, 0.2f, 0.0f), 0.15f, 0.32f, 0.32f);
+    vf ring = sdf_torus(v3_offset(pos, 0.0f, 0.05f, 0.0f), 0.48f, 0.05f);
+    vf neck = sdf_capped_cone(v3_offset(pos, 0.0f, 0.6f, 0.0f), 0.4f, 0.4f, 0.2f);
+    vf neck2 = sdf_capped_cone(v3_offset(pos, 0.0f, 1.0f, 0.0f), 0.03f, 0.3f, 0.3f);
+    vf head = sdf_sphere(v3_offset(pos, 0.0f, 1.3f, 0.0f), 0.3f);
+
+    vf res = base;
+    res = op_smooth_union(res, base2, 0.01f);
+    res = op_smooth_subtraction(res, ring, 0.02f);
+    res = op_smooth_union(res, neck, 0.1f);
+    res = op_smooth_union(res, neck2, 0.05f);
+    res = op_smooth_union(res, head, 0.02f);
+    return res;
+}
+
+static inline vf sdf_rook(vf3 pos)
+{
+    vf base = sdf_capped_cone(pos, 0.1f, 0.5f, 0.5f);
+    vf base2 = sdf_capped_cone(v3_offset(pos, 0.0f, 0.2f, 0.0f), 0.15f, 0.32f, 0.32f);
+    vf ring = sdf_torus(v3_offset(pos, 0.0f, 0.05f, 0.0f), 0.48f, 0.05f);
+    vf neck = sdf_capped_cone(v3_offset(pos, 0.0f, 0.6f, 0.0f), 0.4f, 0.4f, 0.2f);
+    vf neck2 = sdf_capped_cone(v3_offset(pos, 0.0f, 1.0f, 0.0f), 0.03f, 0.3f, 0.3f);
+    vf neck3 = sdf_capped_cone(v3_offset(pos, 0.0f, 1.15f, 0.0f), 0.15f, 0.2f, 0.28f);
+    vf head = sdf_capped_cone(v3_offset(pos, 0.0f, 1.3f, 0.0f), 0.05f, 0.28f, 0.28f);
+    vf3 crown_p = v3_offset(pos, 0.0f, 1.4f, 0.0f);
+    vf crown = sdf_torus(crown_p, 0.255f, 0.05f);
+
+    for (int i = 0; i < 6; i++) {
+        /* rotate_y(p, -angle) */
+        vf c = vf_set1(crown_cos[i]), s = vf_set1(-crown_sin[i]);
+        vf3 p_local = {
+            vf_add(vf_mul(crown_p.x, c), vf_mul(crown_p.z, s)),
+            crown_p.y,
+            vf_sub(vf_mul(crown_p.z, c), vf_mul(crown_p.x, s)),
+        };
+        vf gap = sdf_box(p_local, 0.34f, 0.12f, 0.05f);
+        crown = op_smooth_subtraction(crown, gap, 0.008f);
+    }
+
+    vf res = base;
+    res = op_smooth_union(res, base2, 0.01f);
+    res = op_smooth_subtraction(res, ring, 0.02f);
+    res = op_smooth_union(res, neck, 0.1f);
+    res = op_smooth_union(res, neck2, 0.05f);
+    res = op_smooth_union(res, neck3, 0.02f);
+    res = op_smooth_union(res, head, 0.02f);
+    res = op_smooth_union(res, crown, 0.02f);
+    return res;
+}
+
+/* Scene SDF: must match the default scene (scene_build_default) as rendered
+   by shaders/raymarch.comp. When color is
+   non-NULL it receives the material colour of the closest object. */
+static inline vf scene_sdf(vf3 pos, vf3 *color)
+{
+    vf res = sdf_box(v3_offset(pos, 0.0f, -1.5f, 0.0f), 100.0f, 0.5f, 100.0f);
+    vf piece = vf_set1(INFINITY);
+
+    for (int i = -1; i < 2; i += 2)
+        piece = vf_min(piece, sdf_pawn(v3_offset(pos, (float)i, -1.0f, -5.0f)));
+    piece = vf_min(piece, sdf_rook(v3_offset(pos, 0.0f, -1.0f, -3.0f)));
+
+    /* opUnion keeps the first operand only when strictly closer */
+    vf keep_plane = vf_lt(res, piece);
+    if (color)
+        *color = v3_select(keep_plane, v3_set(0.35f, 0.35f, 0.4f), v3_set(1.0f, 1.0f, 1.0f));
+    return vf_min(res, piece);
+}
+
+static vf3 calc_normal(vf3 p)
+{
+    const float eps = 0.0001f;
+    vf3 n;
+    n.x = vf_sub(scene_sdf(v3_offset(p, -eps, 0.0f, 0.0f), NULL), scene_sdf(v3_offset(p, eps, 0.0f, 0.0f), NULL));
+    n.y = vf_sub(scene_sdf(v3_offset(p, 0.0f, -eps, 0.0f), NULL), scene_sdf(v3_offset(p, 0.0f, eps, 0.0f), NULL));
+    n.z = vf_sub(scene_sdf(v3_offset(p, 0.0f, 0.0f, -eps), NULL), scene_sdf(v3_offset(p, 0.0f, 0.0f, eps), NULL));
+    return v3_normalize(n);
+}
+
+/* Returns the lane mask of rays that hit; lanes march until every ray in the
+   packet has hit or escaped. */
+static vf raymarch(vf3 origin, vf3 dir, vf3 *hit_pos, vf3 *hit_color)
+{
+    const int MAX_STEPS = 128;
+    const vf threshold = vf_set1(0.001f);
+    const vf max_dist = vf_set1(100.0f);
+
+    vf hit = vf_set1(0.0f);
+    vf active = vf_true();
+    vf dist = vf_set1(0.0f);
+    *hit_pos = v3_set(0.0f, 0.0f, 0.0f);
+    *hit_color = v3_set(1.0f, 1.0f, 1.0f);
+
+    for (int step = 0; step < MAX_STEPS; step++) {
+        vf3 p = v3_add(origin, v3_scale(dir, dist));
+        vf3 color;
+        vf d = scene_sdf(p, &color);
+
+        vf new_hit = vf_and(active, vf_lt(d, threshold));
+        hit = vf_or(hit, new_hit);
+        *hit_pos = v3_select(new_hit, p, *hit_pos);
+        *hit_color = v3_select(new_hit, color, *hit_color);
+        active = vf_andnot(new_hit, active);
+
+        dist = vf_select(active, vf_add(dist, d), dist);
+        active = vf_andnot(vf_lt(max_dist, dist), active);
+        if (!vf_any(active))
+            break;
+    }
+    return hit;
+}
+
+static vf calc_ao(vf3 pos, vf3 normal)
+{
+    vf occ = vf_set1(0.0f);
+    float scale = 1.0f;
+    for (int i = 0; i < 5; i++) {
+        float hr = 0.01f + 0.02f * (float)i;
+        vf d = scene_sdf(v3_add(pos, v3_scale(normal, vf_set1(hr))), NULL);
+        occ = vf_add(occ, vf_mul(vf_sub(vf_set1(hr), d), vf_set1(scale)));
+        scale *= 0.75f;
+    }
+    return vf_sub(vf_set1(1.0f), vf_clamp(occ, 0.0f, 1.0f));
+}
+
+/* Soft shadow factor; only lanes set in active are traced. */
+static vf shadow_ray(vf3 origin, vf3 dir, vf max_dist, vf active)
+{
+    const int MAX_STEPS = 64;
+    const vf threshold = vf_set1(0.001f);
+    const float k = 32.0f;
+
+    vf dist = vf_set1(0.0f);
+    vf soft = vf_set1(1.0f);
+
+    for (int step = 0; step < MAX_STEPS; step++) {
+        active = vf_and(active, vf_lt(dist, max_dist));
+        if (!vf_any(active))
+            break;
+
+        vf3 p = v3_add(origin, v3_scale(dir, dist));
+        vf d = scene_sdf(p, NULL);
+
+        vf blocked = vf_and(active, vf_lt(d, threshold));
+        soft = vf_select(blocked, vf_set1(0.0f), soft);
+        active = vf_andnot(blocked, active);
+
+        vf s = vf_div(vf_mul(vf_set1(k), d), vf_max(dist, vf_set1(0.001f)));
+        soft = vf_select(active, vf_min(soft, s), soft);
+        dist = vf_select(active, vf_add(dist, d), dist);
+    }
+    return soft;
+}
+
+static vf3 lambert(vf3 pos, vf3 normal, vf3 light_pos, vf3 base_color)
+{
+    vf3 d = v3_normalize(v3_sub(light_pos, pos));
+    vf intensity = vf_max(vf_set1(0.0f), v3_dot(d, normal));
+    return v3_scale(base_color, intensity);
+}
+
+/* ---- Work-stealing tile scheduler ---- */
+
+#define TILE_SIZE 16
+
+/* A worker's remaining tiles [head, tail), packed into one word so the owner
+   (popping from the head) and thieves (splitting off the tail) can both
+   update it with a single CAS. */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t range;
+} tile_queue;
+
+typedef struct {
+    struct cpu_renderer *r;
+    int index;
+    SDL_Thread *thread;
+} cpu_worker;
+
+struct cpu_renderer {
+    int width;
+    int height;
+    unsigned char *pixels;
+
+    /* Per-frame parameters, published to workers under lock */
+    float origin[3];
+    float fwd[3];
+    float right[3];
+    float up[3];
+    int tiles_x;
+
+    int num_threads;
+    tile_queue *queues;     /* one per thread; index 0 is the calling thread */
+    cpu_worker *workers;    /* num_threads - 1 background threads */
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    SDL_cond *done;
+    unsigned generation;
+    int busy;
+    bool quit;
+};
+
+static inline uint64_t pack_range(uint32_t head, uint32_t tail)
+{
+    return (uint64_t)head | ((uint64_t)tail << 32);
+}
+
+static bool queue_pop(tile_queue *q, uint32_t *tile)
+{
+    uint64_t range = atomic_load(&q->range);
+    for (;;) {
+        uint32_t head = (uint32_t)range, tail = (uint32_t)(range >> 32);
+        if (head >= tail)
+            return false;
+        if (atomic_compare_exchange_weak(&q->range, &range, pack_range(head + 1, tail))) {
+            *tile = head;
+            return true;
+        }
+    }
+}
+
+/* Take the upper half of a victim's remaining tiles. */
+static bool queue_steal(tile_queue *q, uint32_t *first, uint32_t *last)
+{
+    uint64_t range = atomic_load(&q->range);
+    for (;;) {
+        uint32_t head = (uint32_t)range, tail = (uint32_t)(range >> 32);
+        if (head >= tail)
+            return false;
+        uint32_t n = (tail - head + 1) / 2;
+        if (atomic_compare_exchange_weak(&q->range, &range, pack_range(head, tail - n))) {
+            *first = tail - n;
+            *last = tail;
+            return true;
+        }
+    }
+}
+
+static void shade_packet(const cpu_renderer *r, int x0, int y, int count)
+{
+    float aspect = (float)r->width / (float)r->height;
+    float us[VF_WIDTH];
+    for (int i = 0; i < VF_WIDTH; i++)
+        us[i] = (2.0f * ((float)(x0 + i) + 0.5f) / (float)r->width - 1.0f) * aspect;
+    vf u = vf_load(us);
+    vf v = vf_set1(2.0f * ((float)y + 0.5f) / (float)r->height - 1.0f);
+
+    vf3 origin = v3_set(r->origin[0], r->origin[1], r->origin[2]);
+    vf3 right = v3_set(r->right[0], r->right[1], r->right[2]);
+    vf3 up = v3_set(r->up[0], r->up[1], r->up[2]);
+    vf3 fwd = v3_set(r->fwd[0], r->fwd[1], r->fwd[2]);
+    vf3 dir = v3_normalize(v3_add(v3_add(v3_scale(right, u), v3_scale(up, v)), fwd));
+
+    vf3 hit_pos, hit_color;
+    vf hit = raymarch(origin, dir, &hit_pos, &hit_color);
+
+    vf3 col = v3_set(0.15f, 0.15f, 0.2f);
+    if (vf_any(hit)) {
+        vf3 hit_normal = calc_normal(hit_pos);
+        vf3 light_pos = v3_set(5.0f, 10.0f, 3.0f);
+        vf3 to_light = v3_sub(light_pos, hit_pos);
+        vf light_dist = v3_length(to_light);
+        vf3 shadow_origin = v3_add(hit_pos, v3_scale(hit_normal, vf_set1(0.001f)));
+        vf3 shadow_dir = v3_normalize(to_light);
+        vf shadow = shadow_ray(shadow_origin, shadow_dir, vf_sub(light_dist, vf_set1(0.002f)), hit);
+        vf ao = calc_ao(hit_pos, hit_normal);
+
+        vf3 lit = v3_scale(lambert(hit_pos, hit_normal, light_pos, hit_color), vf_mul(shadow, ao));
+        col = v3_select(hit, lit, col);
+    }
+
+    /* Same unorm conversion as imageStore into an rgba8 image */
+    float rs[VF_WIDTH], gs[VF_WIDTH], bs[VF_WIDTH];
+    vf_store(rs, vf_clamp(col.x, 0.0f, 1.0f));
+    vf_store(gs, vf_clamp(col.y, 0.0f, 1.0f));
+    vf_store(bs, vf_clamp(col.z, 0.0f, 1.0f));
+    unsigned char *out = r->pixels + ((size_t)y * (size_t)r->width + (size_t)x0) * 4;
+    for (int i = 0; i < count; i++) {
+        out[i * 4 + 0] = (unsigned char)(rs[i] * 255.0f + 0.5f);
+        out[i * 4 + 1] = (unsigned char)(gs[i] * 255.0f + 0.5f);
+        out[i * 4 + 2] = (unsigned char)(bs[i] * 255.0f + 0.5f);
+        out[i * 4 + 3] = 255;
+    }
+}
+
+static void render_tile(const cpu_renderer *r, uint32_t tile)
+{
+    int x_begin = (int)(tile % (uint32_t)r->tiles_x) * TILE_SIZE;
+    int y_begin = (int)(tile / (uint32_t)r->tiles_x) * TILE_SIZE;
+    int x_end = x_begin + TILE_SIZE < r->width ? x_begin + TILE_SIZE : r->width;
+    int y_end = y_begin + TILE_SIZE < r->height ? y_begin + TILE_SIZE : r->height;
+
+    for (int y = y_begin; y < y_end; y++) {
+        for (int x = x_begin; x < x_end; x += VF_WIDTH) {
+            int count = x_end - x < VF_WIDTH ? x_end - x : VF_WIDTH;
+            shade_packet(r, x, y, count);
+        }
+    }
+}
+
+/* Drain our own queue, then keep stealing until every queue is empty. */
+static void run_tiles(cpu_renderer *r, int self)
+{
+    for (;;) {
+        uint32_t tile;
+        while (queue_pop(&r->queues[self], &tile))
+            render_tile(r, tile);
+
+        bool stole = false;
+        for (int i = 1; i < r->num_threads && !stole; i++) {
+            int victim = (self + i) % r->num_threads;
+            uint32_t first, last;
+            if (queue_steal(&r->queues[victim], &first, &last)) {
+                /* Our queue is empty, so no thief can race this store */
+                atomic_store(&r->queues[self].range, pack_range(first, last));
+                stole = true;
+            }
+        }
+        if (!stole)
+            return;
+    }
+}
+
+static int worker_main(void *data)
+{
+    cpu_worker *w = data;
+    cpu_renderer *r = w->r;
+    unsigned seen = 0;
+
+    SDL_LockMutex(r->lock);
+    for (;;) {
+        while (!r->quit && r->generation == seen)
+            SDL_CondWait(r->wake, r->lock);
+        if (r->quit)
+            break;
+        seen = r->generation;
+        SDL_UnlockMutex(r->lock);
+
+        run_tiles(r, w->index);
+
+        SDL_LockMutex(r->lock);
+        if (--r->busy == 0)
+            SDL_CondSignal(r->done);
+    }
+    SDL_UnlockMutex(r->lock);
+    return 0;
+}
+
+cpu_renderer *cpu_renderer_create(int width, int height, int threads)
+{
+    cpu_renderer *r = calloc(1, sizeof(*r));
+    if (!r)
+        return NULL;
+
+    init_crown_table();
+
+    if (threads <= 0)
+        threads = SDL_GetCPUCount();
+    if (threads < 1)
+        threads = 1;
+    r->num_threads = threads;
+
+    r->queues = aligned_alloc(64, sizeof(tile_queue) * (size_t)threads);
+    r->workers = calloc((size_t)threads, sizeof(cpu_worker));
+    r->lock = SDL_CreateMutex();
+    r->wake = SDL_CreateCond();
+    r->done = SDL_CreateCond();
+    if (!r->queues || !r->workers || !r->lock || !r->wake || !r->done) {
+        cpu_renderer_destroy(r);
+        return NULL;
+    }
+    for (int i = 0; i < threads; i++)
+        atomic_init(&r->queues[i].range, 0);
+
+    if (!cpu_renderer_resize(r, width, height)) {
+        cpu_renderer_destroy(r);
+        return NULL;
+    }
+
+    for (int i = 1; i < threads; i++) {
+        r->workers[i].r = r;
+        r->workers[i].index = i;
+        r->workers[i].thread = SDL_CreateThread(worker_main, "forge-cpu", &r->workers[i]);
+        if (!r->workers[i].thread) {
+            fprintf(stderr, "cpu_renderer: failed to start worker %d: %s\n", i, SDL_GetError());
+            cpu_renderer_destroy(r);
+            return NULL;
+        }
+    }
+
+    return r;
+}
+
+void cpu_renderer_destroy(cpu_renderer *r)
+{
+    if (!r)
+        return;
+    if (r->lock) {
+        SDL_LockMutex(r->lock);
+        r->quit = true;
+        SDL_CondBroadcast(r->wake);
+        SDL_UnlockMutex(r->lock);
+    }
+    if (r->workers) {
+        for (int i = 1; i < r->num_threads; i++)
+            if (r->workers[i].thread)
+                SDL_WaitThread(r->workers[i].thread, NULL);
+        free(r->workers);
+    }
+    if (r->done)
+        SDL_DestroyCond(r->done);
+    if (r->wake)
+        SDL_DestroyCond(r->wake);
+    if (r->lock)
+        SDL_DestroyMutex(r->lock);
+    free(r->queues);
+    free(r->pixels);
+    free(r);
+}
+
+void cpu_renderer_draw(cpu_renderer *r, float time_s, const camera_t *cam)
+{
+    (void)time_s;  /* the scene is static, as in raymarch.comp */
+    if (!r || !r->pixels)
+        return;
+
+    camera_t origin_cam = { 0 };
+    if (!cam)
+        cam = &origin_cam;
+    memcpy(r->origin, cam->pos, sizeof(r->origin));
+    camera_basis(cam, r->fwd, r->right, r->up);
+
+    r->tiles_x = (r->width + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (r->height + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t total = (uint32_t)(r->tiles_x * tiles_y);
+
+    /* Contiguous starting slices keep neighbouring tiles on one core */
+    for (int i = 0; i < r->num_threads; i++) {
+        uint32_t head = (uint32_t)((uint64_t)total * (uint64_t)i / (uint64_t)r->num_threads);
+        uint32_t tail = (uint32_t)((uint64_t)total * (uint64_t)(i + 1) / (uint64_t)r->num_threads);
+        atomic_store(&r->queues[i].range, pack_range(head, tail));
+    }
+
+    SDL_LockMutex(r->lock);
+    r->generation++;
+    r->busy = r->num_threads - 1;
+    SDL_CondBroadcast(r->wake);
+    SDL_UnlockMutex(r->lock);
+
+    run_tiles(r, 0);
+
+    SDL_LockMutex(r->lock);
+    while (r->busy > 0)
+        SDL_CondWait(r->done, r->lock);
+    SDL_UnlockMutex(r->lock);
+}
+
+bool cpu_renderer_resize(cpu_renderer *r, int width, int height)
+{
+    if (!r)
+        return false;
+    unsigned char *pixels = realloc(r->pixels, (size_t)width * (size_t)height * 4);
+    if (!pixels) {
+        fprintf(stderr, "cpu_renderer: failed to allocate %dx%d framebuffer\n", width, height);
+        return false;
+    }
+    r->pixels = pixels;
+    r->width = width;
+    r->height = height;
+    return true;
+}
+
+const unsigned char *cpu_renderer_pixels(const cpu_renderer *r)
+{
+    return r ? r->pixels : NULL;
+}
+
+int cpu_renderer_threads(const cpu_renderer *r)
+{
+    return r ? r->num_threads : 0;
+}
+
+int cpu_renderer_simd_width(void)
+{
+    return VF_WIDTH;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "gl_renderer.h"
+
+#include <stdbool.h>
+
+typedef struct cpu_renderer cpu_renderer;
+
+/* Create the CPU raymarcher. It evaluates the same scene and shading as
+   shaders/raymarch.comp, in SIMD packets of rays spread over a pool of
+   worker threads. threads <= 0 uses one per logical core. Returns NULL on
+   failure. No GL context is required. */
+cpu_renderer *cpu_renderer_create(int width, int height, int threads);
+
+/* Stop the worker threads and free the framebuffer. */
+void cpu_renderer_destroy(cpu_renderer *r);
+
+/* Render a frame into the internal RGBA8 framebuffer; returns when done. */
+void cpu_renderer_draw(cpu_renderer *r, float time_s, const camera_t *cam);
+
+/* Reallocate the framebuffer for a new size. Returns false, keeping the
+   old size and pixels, if it cannot be allocated. */
+bool cpu_renderer_resize(cpu_renderer *r, int width, int height);
+
+/* RGBA8 pixels of the last frame, width * height * 4 bytes, bottom row first
+   (the same layout as the GL output texture). */
+const unsigned char *cpu_renderer_pixels(const cpu_renderer *r);
+
+/* Number of worker threads, including the calling thread. */
+int cpu_renderer_threads(const cpu_renderer *r);
+
+/* Rays evaluated together per SIMD packet (8 with AVX, 4 with SSE2, else 1). */
+int cpu_renderer_simd_width(void);
@@ -1,14 +1,21 @@
 #include "gl_renderer.h"
+#include "scene.h"
 
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 #include <math.h>
 
+#include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static void camera_basis(const camera_t *cam, float fwd[3], float right[3], float up[3])
+void camera_basis(const camera_t *cam, float fwd[3], float right[3], float up[3])
 {
     float cy = cosf(cam->yaw), sy = sinf(cam->yaw);
     float cp = cosf(cam->pitch), sp = sinf(cam->pitch);
@@ -28,18 +35,406 @@ static void camera_basis(const camera_t *cam, float fwd[3], float right[3], floa
     up[2] = right[0] * fwd[1] - right[1] * fwd[0];
 }
 
+void camera_look_at(camera_t *cam, const float target[3])
+{
+    float dx = target[0] - cam->pos[0], dy = target[1] - cam->pos[1], dz = target[2] - cam->pos[2];
+    cam->yaw = atan2f(dx, -dz);
+    cam->pitch = atan2f(dy, sqrtf(dx * dx + dz * dz));
+}
+
+/* Uniform locations, resolved once per link rather than looked up by name
+   every frame. -1 (inactive) is a valid value and makes glUniform a no-op. */
+typedef struct {
+    GLint image;
+    GLint uv_scale;
+    GLint uv_max;
+    GLint cost;
+    GLint cost_view;
+    GLint cost_max;
+} display_uniforms;
+
+/* Per-frame state shared by every pass, laid out as the std140 FrameData
+   block in shaders/frame_data.glsl (vec3 members are padded to 16 bytes). */
+#define FRAME_DATA_BINDING 0
+#define FRAME_RING_SIZE 3
+
+typedef struct {
+    float resolution[2];
+    float time;
+    float pad0;
+    float camera_pos[3];
+    float pad1;
+    float camera_forward[3];
+    float pad2;
+    float camera_right[3];
+    float pad3;
+    float camera_up[3];
+    int32_t object_count;
+    float cache_origin[3];
+    float cache_voxel;
+    int32_t cache_cells[3];
+    int32_t cache_enabled;
+    int32_t dynamic_count;
+    int32_t cone_prepass;
+    float prev_resolution[2];
+    float prev_camera_pos[3];
+    int32_t reproject;
+    float prev_camera_forward[3];
+    float pad5;
+    float prev_camera_right[3];
+    float pad6;
+    float prev_camera_up[3];
+    int32_t normal_mode;
+    int32_t march_mode;
+    int32_t cost_view;
+    int32_t tile_origin[2];
+    float image_size[2];
+    float jitter[2];
+    int32_t accumulate;
+    int32_t sample_index;
+    int32_t edge_aa;
+    int32_t pad7;
+} frame_data;
+
+/* Scene buffer bindings in shaders/scene.glsl. Nodes are a uniform block: every
+   invocation walks the same node list, which is the broadcast access
+   pattern uniform buffers are fastest at (about 1.4x faster per scene_sdf
+   than an SSBO on llvmpipe). Objects and materials are storage buffers. */
+#define SCENE_NODES_BINDING 1
+#define SCENE_OBJECTS_BINDING 2
+#define SCENE_MATERIALS_BINDING 3
+#define SCENE_BVH_BINDING 4
+
+/* Distance cache for static geometry (see scene.glsl and bake.comp). Samples are
+   SDF_CACHE_VOXEL apart in bricks of SDF_CACHE_BRICK^3; the cached volume
+   covers every object smaller than SDF_CACHE_MAX_OBJECT plus a margin, and
+   larger ones (the board) only where they pass through it. */
+#define SDF_CACHE_BRICK 8
+#define SDF_CACHE_ATLAS_BRICKS 32
+#define SDF_CACHE_VOXEL 0.04f
+#define SDF_CACHE_MARGIN 3.0f
+#define SDF_CACHE_MAX_OBJECT 10.0f
+#define SDF_CACHE_MAX_CELLS 128
+#define SDF_CACHE_ATLAS_UNIT 1
+#define SDF_CACHE_COARSE_UNIT 2
+#define SDF_BAKE_BINDING 6
+
+/* Temporal reprojection: image units of the previous and current frame's
+   primary ray distances (see raymarch.comp) */
+#define DEPTH_PREV_UNIT 2
+#define DEPTH_OUT_UNIT 3
+
+/* Cone pre-pass: one start distance per CONE_TILE^2 pixels, at image unit
+   TILE_START_UNIT (see cone.comp) */
+#define CONE_TILE 8
+#define TILE_START_UNIT 4
+
+/* Cost view: per-pixel march steps, shadow steps and AO samples at image
+   unit COST_UNIT, shown by the display pass from texture unit
+   COST_TEXTURE_UNIT. The hot end of the heatmap for each view. */
+#define COST_UNIT 5
+#define COST_TEXTURE_UNIT 1
+static const float cost_view_max[] = { 1.0f, 128.0f, 64.0f, 8.0f, 200.0f };
+
+/* Progressive accumulation: the running sum of jittered samples per pixel
+   at image unit ACCUM_UNIT (see raymarch.comp) */
+#define ACCUM_UNIT 6
+
+/* Adaptive edge anti-aliasing (see shaders/edge_aa.glsl): each pixel's
+   normal and object at image unit EDGE_INFO_UNIT, and the list of edge
+   pixels, behind a 16-byte header of indirect dispatch arguments and the
+   count, at storage binding EDGE_PIXELS_BINDING. raymarch.comp's
+   EDGE_PASS_LOCATION uniform selects the re-sampling dispatch. */
+#define EDGE_INFO_UNIT 7
+#define EDGE_PIXELS_BINDING 7
+#define EDGE_PASS_LOCATION 0
+#define EDGE_HEADER_SIZE 16
+#define EDGE_COUNT_OFFSET 12
+
+/* Dynamic resolution. The raymarch fills the bottom-left render_width x
+   render_height of output_texture and the display pass stretches that over
+   the window. The scale applies per axis, so cost follows its square. */
+#define RENDER_SCALE_MIN 0.25f
+#define RENDER_SCALE_MAX_DROP 0.8f     /* per-frame limits on scale changes */
+#define RENDER_SCALE_MAX_RISE 1.05f
+#define RENDER_SCALE_DEADBAND 0.05f    /* leave the scale alone within 5% of target */
+#define RENDER_TIMER_SMOOTHING 0.3f    /* weight of the newest frame time */
+
+/* GPU pass timing: each draw writes GL_TIMESTAMP queries before the
+   dispatch, after it and after the display quad into the next of
+   TIMER_RING_SIZE slots. Slots are read back only once their results are
+   available, a few frames later, so profiling never stalls the pipeline. */
+#define TIMER_RING_SIZE 4
+#define TIMER_COMPUTE_BEGIN 0
+#define TIMER_COMPUTE_END 1
+#define TIMER_DISPLAY_END 2
+#define TIMER_STAMPS 3
+#define STATS_WINDOW 128               /* frames in the rolling statistics */
+
+/* March statistics: the raymarch sums its costs into one slot of a small
+   storage buffer ring per frame (see shaders/march_stats.glsl), with a
+   histogram of march steps while a cost view is on. A slot is read back
+   once the fence after its frame has signalled, a few frames later, so
+   like the timers, counting never stalls. */
+#define MARCH_STATS_BINDING 5
+#define MARCH_STATS_RING_SIZE 4
+
+typedef struct {
+    GLuint march_steps;
+    GLuint shadow_steps;
+    GLuint ao_samples;
+    GLuint edge_pixels;         /* copied from the edge list's count */
+    GLuint edge_steps;
+    GLuint histogram[GL_RENDERER_COST_BINS];
+} march_stats;
+
+/* Rolling window of one per-frame figure: a pass's time in ms, or steps */
+typedef struct {
+    float value[STATS_WINDOW];
+    int count;
+    int next;
+} pass_history;
+
+/* The programs built from the shader files. The cone, bake and edge
+   programs are optional (0 when they failed to build); the passes they
+   serve are then skipped. The raymarch variants are raymarch.comp with its quality
+   constants overridden; one that failed to build falls back to
+   PROGRAM_COMPUTE, the medium variant. */
+enum {
+    PROGRAM_COMPUTE,        /* main raymarch */
+    PROGRAM_DISPLAY,
+    PROGRAM_CONE,           /* CONE_PREPASS */
+    PROGRAM_BAKE_COARSE,    /* SDF_BAKE_COARSE */
+    PROGRAM_BAKE_BRICKS,    /* SDF_BAKE_BRICKS */
+    PROGRAM_COMPUTE_LOW,
+    PROGRAM_COMPUTE_HIGH,
+    PROGRAM_COMPUTE_NO_SHADOWS,
+    PROGRAM_COMPUTE_NO_AO,
+    PROGRAM_EDGE,           /* edge detection for edge anti-aliasing */
+    PROGRAM_COUNT
+};
+#define PROGRAMS_ALL ((1u << PROGRAM_COUNT) - 1u)
+#define PROGRAMS_REQUIRED ((1u << PROGRAM_COMPUTE) | (1u << PROGRAM_DISPLAY))
+#define PROGRAMS_BAKE ((1u << PROGRAM_BAKE_COARSE) | (1u << PROGRAM_BAKE_BRICKS))
+#define PROGRAMS_RAYMARCH ((1u << PROGRAM_COMPUTE) | (1u << PROGRAM_COMPUTE_LOW) | (1u << PROGRAM_COMPUTE_HIGH) | \
+                           (1u << PROGRAM_COMPUTE_NO_SHADOWS) | (1u << PROGRAM_COMPUTE_NO_AO))
+
+/* Program drawn with for each gl_renderer_variant */
+static const char *const variant_names[GL_RENDERER_VARIANT_COUNT] = {
+    "medium", "low", "high", "no-shadows", "no-ao",
+};
+static const int variant_programs[GL_RENDERER_VARIANT_COUNT] = {
+    [GL_RENDERER_VARIANT_MEDIUM] = PROGRAM_COMPUTE,
+    [GL_RENDERER_VARIANT_LOW] = PROGRAM_COMPUTE_LOW,
+    [GL_RENDERER_VARIANT_HIGH] = PROGRAM_COMPUTE_HIGH,
+    [GL_RENDERER_VARIANT_NO_SHADOWS] = PROGRAM_COMPUTE_NO_SHADOWS,
+    [GL_RENDERER_VARIANT_NO_AO] = PROGRAM_COMPUTE_NO_AO,
+};
+
+/* Every file a program was built from: its stages and whatever they
+   #include. Indices are the GLSL source string numbers in its logs. */
+#define MAX_PROGRAM_FILES 16
+#define MAX_SHADER_PATH 128
+
+typedef struct {
+    int count;
+    char files[MAX_PROGRAM_FILES][MAX_SHADER_PATH];
+} program_deps;
+
+typedef struct {
+    GLuint prog[PROGRAM_COUNT];
+    program_deps deps[PROGRAM_COUNT];   /* from the last build attempted */
+} program_set;
+
+/* How each program is built: its stages and the defines selecting the pass */
+#define MAX_PROGRAM_STAGES 2
+
+typedef struct {
+    int count;
+    GLenum types[MAX_PROGRAM_STAGES];
+    const char *paths[MAX_PROGRAM_STAGES];
+    const char *defines;
+} program_desc;
+
+static const program_desc program_descs[PROGRAM_COUNT] = {
+    [PROGRAM_COMPUTE] = { 1, { GL_COMPUTE_SHADER }, { "shaders/raymarch.comp" }, NULL },
+    [PROGRAM_DISPLAY] = { 2, { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER },
+                          { "shaders/display.vert", "shaders/display.frag" }, NULL },
+    [PROGRAM_CONE] = { 1, { GL_COMPUTE_SHADER }, { "shaders/cone.comp" }, NULL },
+    [PROGRAM_BAKE_COARSE] = { 1, { GL_COMPUTE_SHADER }, { "shaders/bake.comp" }, "#define SDF_BAKE_COARSE\n" },
+    [PROGRAM_BAKE_BRICKS] = { 1, { GL_COMPUTE_SHADER }, { "shaders/bake.comp" }, "#define SDF_BAKE_BRICKS\n" },
+    /* Half the steps, a looser hit threshold and a shorter horizon; short
+       shadow rays and two AO samples */
+    [PROGRAM_COMPUTE_LOW] = { 1, { GL_COMPUTE_SHADER }, { "shaders/raymarch.comp" },
+                              "#define MARCH_MAX_STEPS 64\n#define MARCH_THRESHOLD 0.004\n"
+                              "#define MARCH_MAX_DIST 60.0\n#define SHADOW_MAX_STEPS 24\n"
+                              "#define SHADOW_K 16.0\n#define AO_SAMPLES 2\n" },
+    /* For stills: twice the steps and reach, a tighter threshold */
+    [PROGRAM_COMPUTE_HIGH] = { 1, { GL_COMPUTE_SHADER }, { "shaders/raymarch.comp" },
+                               "#define MARCH_MAX_STEPS 256\n#define MARCH_THRESHOLD 0.0002\n"
+                               "#define MARCH_MAX_DIST 200.0\n#define SHADOW_MAX_STEPS 128\n"
+                               "#define AO_SAMPLES 8\n" },
+    [PROGRAM_COMPUTE_NO_SHADOWS] = { 1, { GL_COMPUTE_SHADER }, { "shaders/raymarch.comp" },
+                                     "#define ENABLE_SHADOWS 0\n" },
+    [PROGRAM_COMPUTE_NO_AO] = { 1, { GL_COMPUTE_SHADER }, { "shaders/raymarch.comp" }, "#define ENABLE_AO 0\n" },
+    [PROGRAM_EDGE] = { 1, { GL_COMPUTE_SHADER }, { "shaders/edge.comp" }, NULL },
+};
+
 struct gl_renderer {
     int width;
     int height;
-    GLuint compute_program;
-    GLuint display_program;
+    program_set programs;
+    display_uniforms display_loc;
+
+    /* FrameData ring: each frame writes the next slot, guarded by a fence so
+       the CPU never overwrites a slot a dispatch is still reading. */
+    GLuint frame_ubo;
+    GLsizeiptr frame_stride;
+    unsigned char *frame_map;   /* persistent mapping, NULL without ARB_buffer_storage */
+    GLsync frame_fences[FRAME_RING_SIZE];
+    int frame_slot;
+
+    /* Scene storage buffers and what was last uploaded into them */
+    scene *default_scene;
+    GLuint scene_nodes_ubo;
+    int max_nodes;                      /* node table size, clamped to GL_MAX_UNIFORM_BLOCK_SIZE */
+    GLuint scene_objects_ssbo;
+    GLuint scene_materials_ssbo;
+    GLuint scene_bvh_ssbo;
+    GLsizeiptr scene_objects_capacity;
+    GLsizeiptr scene_bvh_capacity;
+    scene *uploaded_scene;
+    uint32_t uploaded_version;
+    int object_count;
+    int dynamic_count;
+
+    /* Distance cache: rebaked when the static geometry changes */
+    GLuint cache_atlas;
+    GLuint cache_coarse;
+    bool cache_wanted;
+    bool cache_valid;
+    const scene *cache_scene;
+    uint32_t cache_static_version;
+    float cache_origin[3];
+    float cache_voxel;
+    int cache_cells[3];
+
+    /* Dynamic resolution: compute-pass time comes from the timestamp
+       queries, or else from the CPU interval between draws. Each
+       measurement is rescaled by the pixel count it was taken at, so
+       in-flight frames at an old scale still count. */
+    float target_ms;            /* 0 disables scaling */
+    float render_scale;
+    int render_width;
+    int render_height;
+    float frame_ms;             /* smoothed, at the current pixel count */
+    Uint64 last_draw_ticks;
+    int last_draw_pixels;
+
+    /* Tiled rendering (gl_renderer_draw_tile): the frame being raymarched
+       is the render size tile at tile_origin of an image_size image, which
+       is just the render size for ordinary frames. output_width x
+       output_height is what output_texture holds now. drawing_tile is set
+       while gl_renderer_draw_tile dispatches. */
+    int tile_origin[2];
+    int image_size[2];
+    bool drawing_tile;
+    int output_width;
+    int output_height;
+
+    /* Timestamp ring (llvmpipe reports zero for GL_TIME_ELAPSED around
+       compute, so passes are timed as differences of GL_TIMESTAMPs) */
+    bool timer_queries;
+    GLuint timer_query[TIMER_RING_SIZE][TIMER_STAMPS];
+    int timer_pixels[TIMER_RING_SIZE];   /* 0 when the slot has no queries in flight */
+    int timer_slot;
+    pass_history compute_history;
+    pass_history display_history;
+
+    /* March statistics ring; march_stats_pixels is 0 for a slot with no
+       frame in flight */
+    GLuint march_stats_buffer;
+    GLsizeiptr march_stats_stride;
+    GLsync march_stats_fences[MARCH_STATS_RING_SIZE];
+    int march_stats_pixels[MARCH_STATS_RING_SIZE];
+    bool march_stats_histogram[MARCH_STATS_RING_SIZE];   /* drawn with a cost view */
+    int march_stats_slot;
+    pass_history steps_history;   /* per pixel */
+    pass_history shadow_history;
+    pass_history ao_history;
+    pass_history edge_history;    /* fraction of pixels re-sampled */
+    pass_history edge_steps_history;
+    gl_renderer_cost_histogram histogram;   /* latest read back; frame_pixels 0 before */
+
+    gl_renderer_cost_view cost_view;
+    GLuint cost_texture;        /* allocated on first use */
+
+    /* Progressive accumulation: accum_texture sums accum_samples jittered
+       frames of accum_camera over the same tile and image size. Anything
+       that changes the picture sets accum_samples to 0. */
+    bool accumulate_wanted;
+    GLuint accum_texture;       /* allocated on first use */
+    int accum_samples;
+    camera_t accum_camera;
+    int accum_view[6];          /* render size, tile_origin, image_size */
+
+    /* Adaptive edge anti-aliasing; edge_info and edge_buffer are
+       allocated on first use. Off while accumulating, which already
+       anti-aliases. */
+    bool edge_aa_wanted;
+    GLuint edge_info;
+    GLuint edge_buffer;
+
+    /* Temporal reprojection: depth[depth_current] is written this frame,
+       the other holds the previous frame's, usable while history_valid */
+    bool reproject_wanted;
+    bool history_valid;
+    GLuint depth[2];
+    int depth_current;
+    camera_t prev_camera;
+    int prev_render_width;
+    int prev_render_height;
+
+    /* Cone pre-pass: per-tile start distances */
+    GLuint tile_start;
+    bool cone_wanted;
+
+    gl_renderer_normals normal_mode;
+    gl_renderer_variant variant;
+    gl_renderer_march march_mode;
+
+    /* Asynchronous reload (see gl_renderer_reload_shaders_async). The
+       worker owns reload_programs until it sets reload_done. */
+    SDL_Thread *reload_thread;
+    SDL_atomic_t reload_done;
+    program_set reload_programs;
+    unsigned reload_mask;       /* PROGRAM_* bits the worker is building */
+    unsigned reload_queued;     /* changed since; built once it finishes */
+    bool reload_context_ready;  /* creation attempted */
+    bool reload_sync_only;      /* no shared context: reload synchronously */
+    SDL_Window *reload_window;
+    SDL_GLContext reload_gl_context;
+    EGLContext reload_egl_context;
+
+    /* Program binary cache; program_cache_dir is NULL when it is off */
+    char *program_cache_dir;
+    uint64_t program_cache_key;   /* hash of the driver's identity */
+
     GLuint output_texture;
     GLuint vao;
     GLuint vbo;
     bool ok;
+
+    /* Set when the renderer owns an offscreen EGL context (no window). */
+    bool headless;
+    EGLDisplay egl_display;
+    EGLContext egl_context;
+    EGLSurface egl_surface;
 };
 
-static char *load_file(const char *path)
+/* Read a whole file; size (may be NULL) receives its length. The buffer is
+   NUL-terminated so text can be used as a string. */
+static char *load_file_size(const char *path, size_t *size_out)
 {
     SDL_RWops *f = SDL_RWFromFile(path, "rb");
     if (!f)
@@ -60,93 +455,1171 @@ static char *load_file(const char *path)
     size_t n = SDL_RWread(f, buf, 1, (size_t)size);
     SDL_RWclose(f);
     buf[n] = '\0';
+    if (size_out)
+        *size_out = n;
     return buf;
 }
 
-static GLuint compile_shader(GLenum type, const char *path)
+static char *load_file(const char *path)
+{
+    return load_file_size(path, NULL);
+}
+
+/* Start compiling src (read from path, which only labels errors), with
+   defines (may be NULL) inserted after its #version line. The status is
+   checked by finish_program, so with KHR_parallel_shader_compile several
+   shaders can compile at once. */
+static GLuint compile_shader_source(GLenum type, const char *src, const char *defines)
+{
+    /* #version must stay first: split the source after that line */
+    const char *body = src;
+    if (strncmp(src, "#version", 8) == 0) {
+        const char *eol = strchr(src, '\n');
+        body = eol ? eol + 1 : src + strlen(src);
+    }
+    /* #line keeps compiler messages pointing at lines of the file */
+    const GLchar *parts[4] = { src, defines ? defines : "", body != src ? "#line 2 0\n" : "", body };
+    GLint lengths[4] = { (GLint)(body - src), -1, -1, -1 };
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 4, parts, lengths);
+    glCompileShader(shader);
+    return shader;
+}
+
+/* ---- Program binary cache ----
+   Linked programs are saved with glGetProgramBinary under the cache
+   directory, named by a hash of every stage's source, the defines and the
+   driver's vendor, renderer and version strings. A later build with the
+   same inputs loads the binary instead of compiling, so an edited shader
+   or a different driver simply misses. A binary the driver rejects (e.g.
+   after a driver update that kept its version string) is rebuilt and
+   overwritten. Files for old sources are never read again and can be
+   deleted at any time. */
+#define PROGRAM_CACHE_MAGIC 0x42504746u    /* "FGPB" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t format;                       /* glGetProgramBinary's binaryFormat */
+} program_cache_header;
+
+/* FNV-1a, 64 bit */
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/* Includes the terminator, so consecutive strings cannot run together */
+static uint64_t hash_string(uint64_t h, const char *s)
+{
+    if (!s)
+        s = "";
+    return hash_bytes(h, s, strlen(s) + 1);
+}
+
+/* Create every directory along path (which ends in '/') */
+static bool make_dirs(char *path)
+{
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        bool ok = mkdir(path, 0755) == 0 || errno == EEXIST;
+        *p = '/';
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+/* $FORGE_SHADER_CACHE (empty disables the cache), else
+   $XDG_CACHE_HOME/forge/ or ~/.cache/forge/. NULL when unavailable. */
+static char *program_cache_dir(void)
+{
+    const char *env = getenv("FORGE_SHADER_CACHE");
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char path[1024];
+    int n;
+    if (env)
+        n = *env ? snprintf(path, sizeof(path), "%s/", env) : -1;
+    else if (xdg && *xdg)
+        n = snprintf(path, sizeof(path), "%s/forge/", xdg);
+    else if (home && *home)
+        n = snprintf(path, sizeof(path), "%s/.cache/forge/", home);
+    else
+        n = -1;
+    if (n < 0 || (size_t)n >= sizeof(path) || !make_dirs(path))
+        return NULL;
+    return strdup(path);
+}
+
+/* Called with the context current. Leaves the cache off when the driver
+   offers no binary formats (or no ARB_get_program_binary). */
+static void init_program_cache(struct gl_renderer *r)
+{
+    GLint formats = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats < 1)
+        return;
+    r->program_cache_dir = program_cache_dir();
+
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hash_string(h, (const char *)glGetString(GL_VENDOR));
+    h = hash_string(h, (const char *)glGetString(GL_RENDERER));
+    h = hash_string(h, (const char *)glGetString(GL_VERSION));
+    h = hash_string(h, (const char *)glGetString(GL_SHADING_LANGUAGE_VERSION));
+    r->program_cache_key = h;
+}
+
+static GLuint load_program_binary(const char *file)
+{
+    size_t size;
+    char *data = load_file_size(file, &size);
+    if (!data)
+        return 0;
+
+    GLuint prog = 0;
+    program_cache_header header;
+    if (size > sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+        if (header.magic == PROGRAM_CACHE_MAGIC) {
+            prog = glCreateProgram();
+            glProgramBinary(prog, header.format, data + sizeof(header), (GLsizei)(size - sizeof(header)));
+            GLint success;
+            glGetProgramiv(prog, GL_LINK_STATUS, &success);
+            if (!success) {
+                glDeleteProgram(prog);
+                prog = 0;
+            }
+        }
+    }
+    free(data);
+    return prog;
+}
+
+/* Written to a temporary name and renamed, so a concurrent or interrupted
+   run never sees a partial binary */
+static void save_program_binary(const char *file, GLuint prog)
+{
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    char *data = malloc(sizeof(program_cache_header) + (size_t)length);
+    if (!data)
+        return;
+    program_cache_header header = { PROGRAM_CACHE_MAGIC, 0 };
+    GLsizei written = 0;
+    glGetProgramBinary(prog, length, &written, &header.format, data + sizeof(header));
+    memcpy(data, &header, sizeof(header));
+
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", file, (long)getpid());
+    FILE *f = written > 0 ? fopen(tmp, "wb") : NULL;
+    if (f) {
+        bool ok = fwrite(data, 1, sizeof(header) + (size_t)written, f) == sizeof(header) + (size_t)written;
+        ok = fclose(f) == 0 && ok;
+        if (!ok || rename(tmp, file) != 0)
+            remove(tmp);
+    }
+    free(data);
+}
+
+/* ---- #include ----
+   Shader files may #include "file", resolved against the including file's
+   directory. Each file is pasted in at most once per program, so library
+   files need no include guards, and #include cycles end. Directives are
+   expanded regardless of any surrounding #if. #line directives number
+   each file as its own GLSL source string (its index in program_deps) so
+   compile errors can be traced back to the file and line. */
+#define MAX_INCLUDE_DEPTH 16
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} text_buffer;
+
+static bool text_append(text_buffer *t, const char *s, size_t n)
+{
+    if (t->len + n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 4096;
+        while (cap < t->len + n + 1)
+            cap *= 2;
+        char *data = realloc(t->data, cap);
+        if (!data)
+            return false;
+        t->data = data;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n);
+    t->len += n;
+    t->data[t->len] = '\0';
+    return true;
+}
+
+static bool text_append_line(text_buffer *t, int line, int source)
+{
+    char directive[64];
+    int n = snprintf(directive, sizeof(directive), "#line %d %d\n", line, source);
+    return text_append(t, directive, (size_t)n);
+}
+
+/* If line (n chars) is #include "name", copy name into out */
+static bool parse_include(const char *line, size_t n, char *out, size_t out_size)
 {
+    const char *p = line, *end = line + n;
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p == end || *p++ != '#')
+        return false;
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if ((size_t)(end - p) < 8 || strncmp(p, "include", 7) != 0)
+        return false;
+    p += 7;
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p == end || *p++ != '"')
+        return false;
+    const char *name = p;
+    while (p < end && *p != '"')
+        p++;
+    if (p == end || (size_t)(p - name) >= out_size)
+        return false;
+    memcpy(out, name, (size_t)(p - name));
+    out[p - name] = '\0';
+    return true;
+}
+
+/* Append path to out with its #includes expanded, recording every file
+   read in deps. */
+static bool expand_includes(text_buffer *out, program_deps *deps, const char *path, int depth)
+{
+    for (int i = 0; i < deps->count; i++) {
+        if (strcmp(deps->files[i], path) == 0)
+            return true;
+    }
+    if (depth > MAX_INCLUDE_DEPTH || deps->count == MAX_PROGRAM_FILES || strlen(path) >= MAX_SHADER_PATH) {
+        fprintf(stderr, "gl_renderer: cannot include %s (too deep, too many files or path too long)\n", path);
+        return false;
+    }
+    int source = deps->count++;
+    strcpy(deps->files[source], path);
+
     char *src = load_file(path);
     if (!src) {
         fprintf(stderr, "gl_renderer: failed to load shader %s\n", path);
-        return 0;
+        return false;
     }
+    const char *slash = strrchr(path, '/');
+    int dir_len = slash ? (int)(slash - path + 1) : 0;
 
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, (const GLchar *const *)&src, NULL);
+    bool ok = depth == 0 || text_append_line(out, 1, source);
+    int line = 1;
+    for (const char *p = src; *p && ok; line++) {
+        const char *eol = strchr(p, '\n');
+        size_t n = eol ? (size_t)(eol - p + 1) : strlen(p);
+        char name[MAX_SHADER_PATH], included[MAX_SHADER_PATH];
+        if (parse_include(p, n, name, sizeof(name))) {
+            int len = snprintf(included, sizeof(included), "%.*s%s", dir_len, path, name);
+            ok = len > 0 && (size_t)len < sizeof(included) &&
+                 expand_includes(out, deps, included, depth + 1) &&
+                 text_append_line(out, line + 1, source);
+            if (!ok)
+                fprintf(stderr, "gl_renderer: in %s:%d\n", path, line);
+        } else {
+            ok = text_append(out, p, n) && (eol || text_append(out, "\n", 1));
+        }
+        p += n;
+    }
     free(src);
+    return ok;
+}
 
-    glCompileShader(shader);
+/* A program between start_program and finish_program: either loaded from
+   the cache (no shaders), or compiling and linking from source */
+typedef struct {
+    GLuint prog;
+    int count;
+    GLuint shaders[MAX_PROGRAM_STAGES];
+    const char *paths[MAX_PROGRAM_STAGES];
+    bool save;                          /* write the binary to file once linked */
+    char file[1024];
+    program_deps deps;
+} program_build;
+
+/* Start building a program from count stages (types[i] read from
+   paths[i]), each compiled with defines. Loaded from the binary cache when
+   possible; otherwise compiled and linked without waiting for either. */
+static void start_program(struct gl_renderer *r, program_build *b, const GLenum *types,
+                          const char *const *paths, int count, const char *defines)
+{
+    memset(b, 0, sizeof(*b));
+    /* Every program sees the node table size chosen for this driver */
+    char all_defines[1024];
+    snprintf(all_defines, sizeof(all_defines), "#define SCENE_MAX_NODES %d\n%s", r->max_nodes,
+             defines ? defines : "");
+    defines = all_defines;
+    text_buffer srcs[MAX_PROGRAM_STAGES] = { { NULL, 0, 0 } };
+    bool loaded = true;
+    uint64_t h = r->program_cache_key;
+    for (int i = 0; i < count && loaded; i++) {
+        loaded = expand_includes(&srcs[i], &b->deps, paths[i], 0);
+        h = hash_bytes(h, &types[i], sizeof(types[i]));
+        h = hash_string(h, srcs[i].data);
+    }
+    h = hash_string(h, defines);
+
+    bool cached = loaded && r->program_cache_dir &&
+                  snprintf(b->file, sizeof(b->file), "%s%016llx.bin", r->program_cache_dir,
+                           (unsigned long long)h) < (int)sizeof(b->file);
+    if (cached)
+        b->prog = load_program_binary(b->file);
+
+    if (loaded && !b->prog) {
+        b->prog = glCreateProgram();
+        if (cached)
+            glProgramParameteri(b->prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        b->count = count;
+        b->save = cached;
+        for (int i = 0; i < count; i++) {
+            b->shaders[i] = compile_shader_source(types[i], srcs[i].data, defines);
+            b->paths[i] = paths[i];
+            glAttachShader(b->prog, b->shaders[i]);
+        }
+        glLinkProgram(b->prog);
+    }
+
+    for (int i = 0; i < count; i++)
+        free(srcs[i].data);
+}
+
+/* Wait for a started program and report any compile or link errors.
+   Returns the program, or 0 on failure. */
+static GLuint finish_program(program_build *b)
+{
+    GLuint prog = b->prog;
+    if (!prog || b->count == 0)
+        return prog;
 
     GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    glGetProgramiv(prog, GL_LINK_STATUS, &success);
     if (!success) {
         char log[512];
-        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
-        fprintf(stderr, "gl_renderer: shader %s compile failed:\n%s\n", path, log);
-        glDeleteShader(shader);
-        return 0;
+        bool compiled = true;
+        for (int i = 0; i < b->count; i++) {
+            GLint ok;
+            glGetShaderiv(b->shaders[i], GL_COMPILE_STATUS, &ok);
+            if (!ok) {
+                glGetShaderInfoLog(b->shaders[i], sizeof(log), NULL, log);
+                fprintf(stderr, "gl_renderer: shader %s compile failed:\n%s\n", b->paths[i], log);
+                compiled = false;
+            }
+        }
+        /* Log positions read source:line; name the sources */
+        if (!compiled && b->deps.count > 1) {
+            for (int i = 0; i < b->deps.count; i++)
+                fprintf(stderr, "  source %d: %s\n", i, b->deps.files[i]);
+        }
+        if (compiled) {
+            glGetProgramInfoLog(prog, sizeof(log), NULL, log);
+            fprintf(stderr, "gl_renderer: program link failed:\n%s\n", log);
+        }
+        glDeleteProgram(prog);
+        prog = 0;
     }
+    for (int i = 0; i < b->count; i++)
+        glDeleteShader(b->shaders[i]);
 
-    return shader;
+    if (prog && b->save)
+        save_program_binary(b->file, prog);
+    return prog;
+}
+
+static void resolve_display_uniforms(GLuint prog, display_uniforms *u)
+{
+    u->image = glGetUniformLocation(prog, "u_image");
+    u->uv_scale = glGetUniformLocation(prog, "u_uv_scale");
+    u->uv_max = glGetUniformLocation(prog, "u_uv_max");
+    u->cost = glGetUniformLocation(prog, "u_cost");
+    u->cost_view = glGetUniformLocation(prog, "u_cost_view");
+    u->cost_max = glGetUniformLocation(prog, "u_cost_max");
+}
+
+static void create_output_texture(struct gl_renderer *r)
+{
+    if (r->output_texture)
+        glDeleteTextures(1, &r->output_texture);
+
+    glGenTextures(1, &r->output_texture);
+    glBindTexture(GL_TEXTURE_2D, r->output_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, r->width, r->height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    /* Depth images are only accessed with imageLoad/imageStore */
+    if (r->depth[0])
+        glDeleteTextures(2, r->depth);
+    glGenTextures(2, r->depth);
+    for (int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, r->depth[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, r->width, r->height);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    r->history_valid = false;
+
+    if (r->tile_start)
+        glDeleteTextures(1, &r->tile_start);
+    glGenTextures(1, &r->tile_start);
+    glBindTexture(GL_TEXTURE_2D, r->tile_start);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, (r->width + CONE_TILE - 1) / CONE_TILE,
+                   (r->height + CONE_TILE - 1) / CONE_TILE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    /* Reallocated at the new size when a cost view next needs it */
+    if (r->cost_texture)
+        glDeleteTextures(1, &r->cost_texture);
+    r->cost_texture = 0;
+
+    /* Likewise the accumulation image, whose sum starts over */
+    if (r->accum_texture)
+        glDeleteTextures(1, &r->accum_texture);
+    r->accum_texture = 0;
+    r->accum_samples = 0;
+
+    /* And the edge buffers, which hold up to one entry per pixel */
+    if (r->edge_info)
+        glDeleteTextures(1, &r->edge_info);
+    r->edge_info = 0;
+    if (r->edge_buffer)
+        glDeleteBuffers(1, &r->edge_buffer);
+    r->edge_buffer = 0;
+}
+
+/* The accumulation image, the size of output_texture; read and written
+   only with imageLoad/imageStore */
+static void create_accum_texture(struct gl_renderer *r)
+{
+    glGenTextures(1, &r->accum_texture);
+    glBindTexture(GL_TEXTURE_2D, r->accum_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, r->width, r->height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/* The edge info image and the edge pixel list, for output_texture's size */
+static void create_edge_buffers(struct gl_renderer *r)
+{
+    glGenTextures(1, &r->edge_info);
+    glBindTexture(GL_TEXTURE_2D, r->edge_info);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, r->width, r->height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &r->edge_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->edge_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, EDGE_HEADER_SIZE + (GLsizeiptr)r->width * r->height * 4, NULL,
+                 GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/* The cost image, the size of output_texture */
+static void create_cost_texture(struct gl_renderer *r)
+{
+    glGenTextures(1, &r->cost_texture);
+    glBindTexture(GL_TEXTURE_2D, r->cost_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16UI, r->width, r->height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void create_frame_ring(struct gl_renderer *r)
+{
+    GLint align = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    r->frame_stride = ((GLsizeiptr)sizeof(frame_data) + align - 1) / align * align;
+    GLsizeiptr size = r->frame_stride * FRAME_RING_SIZE;
+
+    glGenBuffers(1, &r->frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, r->frame_ubo);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+        r->frame_map = glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+        if (!r->frame_map) {
+            /* Immutable storage without GL_DYNAMIC_STORAGE_BIT takes no
+               glBufferSubData, so fall back to a fresh mutable buffer */
+            fprintf(stderr, "gl_renderer: cannot map the frame data ring, updating it by copies\n");
+            glDeleteBuffers(1, &r->frame_ubo);
+            glGenBuffers(1, &r->frame_ubo);
+            glBindBuffer(GL_UNIFORM_BUFFER, r->frame_ubo);
+        }
+    }
+    if (!r->frame_map)
+        glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+static void destroy_frame_ring(struct gl_renderer *r)
+{
+    for (int i = 0; i < FRAME_RING_SIZE; i++) {
+        if (r->frame_fences[i])
+            glDeleteSync(r->frame_fences[i]);
+        r->frame_fences[i] = 0;
+    }
+    if (r->frame_map) {
+        glBindBuffer(GL_UNIFORM_BUFFER, r->frame_ubo);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        r->frame_map = NULL;
+    }
+    if (r->frame_ubo)
+        glDeleteBuffers(1, &r->frame_ubo);
+    r->frame_ubo = 0;
+}
+
+static void push_history(pass_history *h, float value)
+{
+    h->value[h->next] = value;
+    h->next = (h->next + 1) % STATS_WINDOW;
+    if (h->count < STATS_WINDOW)
+        h->count++;
+}
+
+static void create_march_stats(struct gl_renderer *r)
+{
+    GLint align = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+    r->march_stats_stride = ((GLsizeiptr)sizeof(march_stats) + align - 1) / align * align;
+    glGenBuffers(1, &r->march_stats_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->march_stats_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, r->march_stats_stride * MARCH_STATS_RING_SIZE, NULL, GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static void destroy_march_stats(struct gl_renderer *r)
+{
+    for (int i = 0; i < MARCH_STATS_RING_SIZE; i++) {
+        if (r->march_stats_fences[i])
+            glDeleteSync(r->march_stats_fences[i]);
+        r->march_stats_fences[i] = 0;
+    }
+    if (r->march_stats_buffer)
+        glDeleteBuffers(1, &r->march_stats_buffer);
+    r->march_stats_buffer = 0;
+}
+
+/* Read back finished stats slots, oldest first, stopping at the first
+   frame the GPU has not finished. With wait, the oldest slot in flight is
+   waited for if need be. */
+static void collect_march_stats(struct gl_renderer *r, bool wait)
+{
+    for (int i = 0; i < MARCH_STATS_RING_SIZE; i++) {
+        int slot = (r->march_stats_slot + i) % MARCH_STATS_RING_SIZE;
+        if (!r->march_stats_pixels[slot])
+            continue;
+        GLenum status = glClientWaitSync(r->march_stats_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         wait ? 1000000000ull : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        wait = false;
+        march_stats stats;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->march_stats_buffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, r->march_stats_stride * slot, sizeof(stats), &stats);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        float pixels = (float)r->march_stats_pixels[slot];
+        push_history(&r->steps_history, (float)stats.march_steps / pixels);
+        push_history(&r->shadow_history, (float)stats.shadow_steps / pixels);
+        push_history(&r->ao_history, (float)stats.ao_samples / pixels);
+        push_history(&r->edge_history, (float)stats.edge_pixels / pixels);
+        push_history(&r->edge_steps_history, (float)stats.edge_steps / pixels);
+        if (r->march_stats_histogram[slot]) {
+            memcpy(r->histogram.pixels, stats.histogram, sizeof(r->histogram.pixels));
+            r->histogram.frame_pixels = r->march_stats_pixels[slot];
+        }
+        glDeleteSync(r->march_stats_fences[slot]);
+        r->march_stats_fences[slot] = 0;
+        r->march_stats_pixels[slot] = 0;
+    }
+}
+
+/* Zero the next stats slot and bind it for this frame's raymarch */
+static void begin_march_stats(struct gl_renderer *r)
+{
+    int slot = r->march_stats_slot;
+    /* Normally long finished: only waits when MARCH_STATS_RING_SIZE frames are in flight */
+    if (r->march_stats_pixels[slot])
+        collect_march_stats(r, true);
+    GLintptr offset = r->march_stats_stride * slot;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->march_stats_buffer);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, offset, sizeof(march_stats), GL_RED_INTEGER,
+                         GL_UNSIGNED_INT, NULL);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MARCH_STATS_BINDING, r->march_stats_buffer, offset,
+                      sizeof(march_stats));
+}
+
+/* After the raymarch dispatch: mark the slot in flight */
+static void end_march_stats(struct gl_renderer *r)
+{
+    int slot = r->march_stats_slot;
+    r->march_stats_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    r->march_stats_pixels[slot] = r->render_width * r->render_height;
+    r->march_stats_histogram[slot] = r->cost_view != GL_RENDERER_COST_OFF;
+    r->march_stats_slot = (slot + 1) % MARCH_STATS_RING_SIZE;
+}
+
+/* Whether this frame runs the edge anti-aliasing passes. Not for tiles:
+   edge detection cannot see across a tile's border, so its pixels there
+   would be left aliased. */
+static bool edge_aa_active(const struct gl_renderer *r)
+{
+    return r->edge_aa_wanted && !r->accumulate_wanted && !r->drawing_tile && r->programs.prog[PROGRAM_EDGE];
+}
+
+/* Radical inverse of i in base: the Halton sequence, in [0, 1) */
+static float halton(int i, int base)
+{
+    float f = 1.0f, result = 0.0f;
+    for (; i > 0; i /= base) {
+        f /= (float)base;
+        result += f * (float)(i % base);
+    }
+    return result;
+}
+
+/* Write this frame's FrameData into the next ring slot and bind it. */
+static void upload_frame_data(struct gl_renderer *r, float time_s, const camera_t *cam)
+{
+    frame_data fd = { 0 };
+    fd.resolution[0] = (float)r->render_width;
+    fd.resolution[1] = (float)r->render_height;
+    fd.time = time_s;
+    memcpy(fd.camera_pos, cam->pos, sizeof(fd.camera_pos));
+    camera_basis(cam, fd.camera_forward, fd.camera_right, fd.camera_up);
+    fd.object_count = r->object_count;
+    memcpy(fd.cache_origin, r->cache_origin, sizeof(fd.cache_origin));
+    fd.cache_voxel = r->cache_voxel;
+    memcpy(fd.cache_cells, r->cache_cells, sizeof(fd.cache_cells));
+    fd.cache_enabled = r->cache_wanted && r->cache_valid;
+    fd.dynamic_count = r->dynamic_count;
+    fd.reproject = r->reproject_wanted && r->history_valid;
+    fd.cone_prepass = r->cone_wanted && r->programs.prog[PROGRAM_CONE];
+    fd.normal_mode = (int32_t)r->normal_mode;
+    fd.march_mode = (int32_t)r->march_mode;
+    fd.cost_view = r->cost_view != GL_RENDERER_COST_OFF;
+    memcpy(fd.tile_origin, r->tile_origin, sizeof(fd.tile_origin));
+    fd.image_size[0] = (float)r->image_size[0];
+    fd.image_size[1] = (float)r->image_size[1];
+    /* Sample i sits at the Halton (2, 3) point i, shifted so the first
+       sample is the pixel centre */
+    fd.jitter[0] = fd.jitter[1] = 0.5f;
+    if (r->accumulate_wanted) {
+        fd.jitter[0] = fmodf(0.5f + halton(r->accum_samples, 2), 1.0f);
+        fd.jitter[1] = fmodf(0.5f + halton(r->accum_samples, 3), 1.0f);
+    }
+    fd.accumulate = r->accumulate_wanted;
+    fd.sample_index = r->accum_samples;
+    fd.edge_aa = edge_aa_active(r);
+    fd.prev_resolution[0] = (float)r->prev_render_width;
+    fd.prev_resolution[1] = (float)r->prev_render_height;
+    memcpy(fd.prev_camera_pos, r->prev_camera.pos, sizeof(fd.prev_camera_pos));
+    camera_basis(&r->prev_camera, fd.prev_camera_forward, fd.prev_camera_right, fd.prev_camera_up);
+
+    int slot = r->frame_slot;
+    r->frame_slot = (slot + 1) % FRAME_RING_SIZE;
+    GLintptr offset = r->frame_stride * slot;
+
+    if (r->frame_map) {
+        /* Normally already signalled: the slot was used FRAME_RING_SIZE frames ago */
+        if (r->frame_fences[slot]) {
+            glClientWaitSync(r->frame_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(r->frame_fences[slot]);
+            r->frame_fences[slot] = 0;
+        }
+        memcpy(r->frame_map + offset, &fd, sizeof(fd));
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, r->frame_ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(fd), &fd);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, r->frame_ubo, offset, sizeof(fd));
+}
+
+/* Mark the slot just bound as in flight until the GPU passes this point. */
+static void fence_frame_data(struct gl_renderer *r)
+{
+    if (!r->frame_map)
+        return;
+    int slot = (r->frame_slot + FRAME_RING_SIZE - 1) % FRAME_RING_SIZE;
+    r->frame_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/* (Re)allocate buf to hold size bytes and fill it from data. */
+static void upload_storage(GLuint buf, GLsizeiptr size, const void *data)
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+    /* Zero-sized SSBOs are not bindable; keep at least one element */
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size > 0 ? size : 64, size > 0 ? data : NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/* The programs in mask (PROGRAM_* bits); the rest of set is left 0. All of
+   them are started before any is waited on, so a driver with
+   KHR_parallel_shader_compile builds them side by side. */
+static void build_programs(struct gl_renderer *r, program_set *set, unsigned mask)
+{
+    program_build builds[PROGRAM_COUNT];
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        const program_desc *d = &program_descs[i];
+        if (mask & (1u << i))
+            start_program(r, &builds[i], d->types, d->paths, d->count, d->defines);
+    }
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        set->prog[i] = (mask & (1u << i)) ? finish_program(&builds[i]) : 0;
+        set->deps[i] = (mask & (1u << i)) ? builds[i].deps : (program_deps){ 0 };
+    }
+}
+
+static void delete_programs(program_set *set)
+{
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        if (set->prog[i])
+            glDeleteProgram(set->prog[i]);
+        set->prog[i] = 0;
+    }
+}
+
+/* Programs built from path (a shader file, e.g. "shaders/sdf.glsl"),
+   directly or through #include */
+static unsigned programs_using_file(const struct gl_renderer *r, const char *path)
+{
+    unsigned mask = 0;
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        const program_deps *deps = &r->programs.deps[i];
+        for (int j = 0; j < deps->count; j++) {
+            if (strcmp(deps->files[j], path) == 0)
+                mask |= 1u << i;
+        }
+        for (int j = 0; j < program_descs[i].count; j++) {
+            if (strcmp(program_descs[i].paths[j], path) == 0)
+                mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+/* Replace the renderer's programs in mask with those of set, which is
+   consumed. The raymarch and display programs are required: if either was
+   rebuilt and failed, nothing changes and false is returned. The cone and
+   bake programs only save work, so a failed one keeps its predecessor (or
+   stays unavailable); the two bake passes are only replaced together. */
+static void bake_distance_cache(struct gl_renderer *r, scene *s);
+
+static bool install_programs(struct gl_renderer *r, program_set *set, unsigned mask)
+{
+    /* Even a failed build's files are watched, so fixing any of them
+       triggers the next attempt */
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        if ((mask & (1u << i)) && set->deps[i].count > 0)
+            r->programs.deps[i] = set->deps[i];
+    }
+
+    unsigned built = 0;
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        if (set->prog[i])
+            built |= 1u << i;
+    }
+    if ((mask & PROGRAMS_REQUIRED) & ~built) {
+        delete_programs(set);
+        return false;
+    }
+    unsigned replace = mask & built;
+    if ((replace & PROGRAMS_BAKE) != PROGRAMS_BAKE)
+        replace &= ~PROGRAMS_BAKE;
+
+    for (int i = 0; i < PROGRAM_COUNT; i++) {
+        if (!(replace & (1u << i)))
+            continue;
+        if (r->programs.prog[i])
+            glDeleteProgram(r->programs.prog[i]);
+        r->programs.prog[i] = set->prog[i];
+        set->prog[i] = 0;
+    }
+    delete_programs(set);
+
+    if (replace & PROGRAMS_RAYMARCH) {
+        r->history_valid = false;
+        r->accum_samples = 0;
+    }
+    /* The bake passes include the whole SDF library, so a change to any of
+       their files may have changed the distances the cache holds: rebake
+       with the new passes, or drop the cache if they failed to build */
+    if (mask & PROGRAMS_BAKE) {
+        r->cache_valid = false;
+        r->cache_scene = NULL;
+        if (r->cache_wanted && (replace & PROGRAMS_BAKE) && r->uploaded_scene)
+            bake_distance_cache(r, r->uploaded_scene);
+    }
+    if (replace & (1u << PROGRAM_DISPLAY))
+        resolve_display_uniforms(r->programs.prog[PROGRAM_DISPLAY], &r->display_loc);
+    return true;
+}
+
+/* Pick the cached volume and its sample spacing from the BVH leaves.
+   Returns false when there is nothing small enough to be worth caching. */
+static bool choose_cache_volume(struct gl_renderer *r, scene *s)
+{
+    int count;
+    const gpu_bvh_node *bvh = scene_bvh(s, &count);
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (int i = 0; i < count; i++) {
+        const gpu_bvh_node *n = &bvh[i];
+        if (n->object < 0 || fmaxf(n->extent[0], fmaxf(n->extent[1], n->extent[2])) > SDF_CACHE_MAX_OBJECT)
+            continue;
+        for (int j = 0; j < 3; j++) {
+            lo[j] = fminf(lo[j], n->centre[j] - n->extent[j] - SDF_CACHE_MARGIN);
+            hi[j] = fmaxf(hi[j], n->centre[j] + n->extent[j] + SDF_CACHE_MARGIN);
+        }
+    }
+    if (lo[0] > hi[0])
+        return false;
+
+    /* Coarser samples rather than an unbounded grid for spread-out scenes */
+    float size = fmaxf(hi[0] - lo[0], fmaxf(hi[1] - lo[1], hi[2] - lo[2]));
+    float voxel = fmaxf(SDF_CACHE_VOXEL, size / (float)(SDF_CACHE_MAX_CELLS * (SDF_CACHE_BRICK - 1)));
+    float brick = voxel * (float)(SDF_CACHE_BRICK - 1);
+    for (int j = 0; j < 3; j++) {
+        r->cache_origin[j] = lo[j];
+        r->cache_cells[j] = (int)ceilf((hi[j] - lo[j]) / brick);
+    }
+    r->cache_voxel = voxel;
+    return true;
+}
+
+/* Bake the static objects of s into the sparse distance cache: a coarse
+   pass evaluates every brick centre, bricks the surface may pass through
+   get atlas slots, and a second pass fills those bricks. */
+static void bake_distance_cache(struct gl_renderer *r, scene *s)
+{
+    r->cache_valid = false;
+    r->cache_scene = s;
+    r->cache_static_version = scene_static_version(s);
+    if (!r->programs.prog[PROGRAM_BAKE_COARSE] || !choose_cache_volume(r, s))
+        return;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    int cx = r->cache_cells[0], cy = r->cache_cells[1], cz = r->cache_cells[2];
+    int cells = cx * cy * cz;
+    float *centre_dist = malloc(sizeof(float) * (size_t)cells);
+    float *coarse = malloc(sizeof(float) * 2 * (size_t)cells);
+    int32_t *bricks = malloc(sizeof(int32_t) * 4 * (size_t)cells);
+    if (!centre_dist || !coarse || !bricks) {
+        free(centre_dist);
+        free(coarse);
+        free(bricks);
+        return;
+    }
+
+    /* The bake reads its parameters from FrameData like a frame would */
+    camera_t origin_cam = { 0 };
+    upload_frame_data(r, 0.0f, &origin_cam);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SCENE_NODES_BINDING, r->scene_nodes_ubo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_OBJECTS_BINDING, r->scene_objects_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_MATERIALS_BINDING, r->scene_materials_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_BVH_BINDING, r->scene_bvh_ssbo);
+
+    GLuint scratch;
+    glGenBuffers(1, &scratch);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, scratch);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * (GLsizeiptr)cells, NULL, GL_STREAM_READ);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SDF_BAKE_BINDING, scratch);
+    glUseProgram(r->programs.prog[PROGRAM_BAKE_COARSE]);
+    glDispatchCompute((GLuint)(cx + 7) / 8, (GLuint)(cy + 7) / 8, (GLuint)(cz + 7) / 8);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float) * (GLsizeiptr)cells, centre_dist);
+
+    /* A brick can hold surface if its centre is within half a diagonal
+       (plus interpolation slack) of it. Empty bricks outside geometry keep
+       their centre distance, which bounds the distance anywhere in them. */
+    float brick_size = r->cache_voxel * (float)(SDF_CACHE_BRICK - 1);
+    float half_diag = 0.8660254f * brick_size;
+    float slack = 2.0f * r->cache_voxel;
+    int slots = 0;
+    for (int i = 0; i < cells; i++) {
+        float d = centre_dist[i];
+        if (fabsf(d) < half_diag + slack) {
+            coarse[2 * i] = 0.0f;
+            coarse[2 * i + 1] = (float)slots++;
+        } else {
+            coarse[2 * i] = d > 0.0f ? d : -1.0f;
+            coarse[2 * i + 1] = -1.0f;
+        }
+    }
+    for (int i = 0, n = 0; i < cells; i++) {
+        if (coarse[2 * i + 1] < 0.0f)
+            continue;
+        int32_t *b = bricks + 4 * n++;
+        b[0] = i % cx;
+        b[1] = (i / cx) % cy;
+        b[2] = i / (cx * cy);
+        b[3] = (int32_t)coarse[2 * i + 1];
+    }
+
+    const int per_layer = SDF_CACHE_ATLAS_BRICKS * SDF_CACHE_ATLAS_BRICKS;
+    GLint max_3d = 256;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_3d);
+    int layers = (slots + per_layer - 1) / per_layer;
+    if (slots == 0 || layers * SDF_CACHE_BRICK > max_3d) {
+        if (slots > 0)
+            fprintf(stderr, "gl_renderer: distance cache needs %d bricks, too many; disabled\n", slots);
+        glDeleteBuffers(1, &scratch);
+        free(centre_dist);
+        free(coarse);
+        free(bricks);
+        return;
+    }
+
+    if (r->cache_coarse)
+        glDeleteTextures(1, &r->cache_coarse);
+    glGenTextures(1, &r->cache_coarse);
+    glBindTexture(GL_TEXTURE_3D, r->cache_coarse);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RG32F, cx, cy, cz);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, cx, cy, cz, GL_RG, GL_FLOAT, coarse);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    int ax = (slots < SDF_CACHE_ATLAS_BRICKS ? slots : SDF_CACHE_ATLAS_BRICKS) * SDF_CACHE_BRICK;
+    int rows = (slots + SDF_CACHE_ATLAS_BRICKS - 1) / SDF_CACHE_ATLAS_BRICKS;
+    int ay = (rows < SDF_CACHE_ATLAS_BRICKS ? rows : SDF_CACHE_ATLAS_BRICKS) * SDF_CACHE_BRICK;
+    int az = layers * SDF_CACHE_BRICK;
+    if (r->cache_atlas)
+        glDeleteTextures(1, &r->cache_atlas);
+    glGenTextures(1, &r->cache_atlas);
+    glBindTexture(GL_TEXTURE_3D, r->cache_atlas);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16F, ax, ay, az);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, scratch);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(int32_t) * 4 * (GLsizeiptr)slots, bricks, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SDF_BAKE_BINDING, scratch);
+    glBindImageTexture(SDF_CACHE_ATLAS_UNIT, r->cache_atlas, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R16F);
+    glUseProgram(r->programs.prog[PROGRAM_BAKE_BRICKS]);
+    int groups_x = slots < 256 ? slots : 256;
+    glDispatchCompute((GLuint)groups_x, (GLuint)((slots + groups_x - 1) / groups_x), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    fence_frame_data(r);
+    glFinish();
+
+    glDeleteBuffers(1, &scratch);
+    free(centre_dist);
+    free(coarse);
+    free(bricks);
+    r->cache_valid = true;
+
+    double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    fprintf(stderr, "gl_renderer: distance cache baked: %dx%dx%d bricks, %d filled (%.1f MB), %.1f ms\n",
+            cx, cy, cz, slots, (double)ax * ay * az * 2.0 / (1024.0 * 1024.0), ms);
+}
+
+bool gl_renderer_set_scene(gl_renderer *r, scene *s)
+{
+    if (!r || !r->ok || !s)
+        return false;
+    if (scene_node_count(s) > r->max_nodes) {
+        fprintf(stderr, "gl_renderer: scene has %d nodes, limit is %d\n", scene_node_count(s), r->max_nodes);
+        return false;
+    }
+    /* Built before anything is uploaded, so a failure leaves the previous
+       scene in place rather than objects without their hierarchy */
+    int bvh_count;
+    const gpu_bvh_node *bvh = scene_bvh(s, &bvh_count);
+    if (!bvh && scene_object_count(s) > 0) {
+        fprintf(stderr, "gl_renderer: failed to build the scene's bounding volume hierarchy\n");
+        return false;
+    }
+
+    int count = scene_object_count(s);
+    GLsizeiptr objects_size = (GLsizeiptr)count * (GLsizeiptr)sizeof(gpu_scene_object);
+
+    if (s != r->uploaded_scene || scene_structure_version(s) != r->uploaded_version ||
+        objects_size > r->scene_objects_capacity) {
+        /* Structure changed: re-specify every buffer */
+        glBindBuffer(GL_UNIFORM_BUFFER, r->scene_nodes_ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0,
+                        (GLsizeiptr)scene_node_count(s) * (GLsizeiptr)sizeof(gpu_scene_node), scene_nodes(s));
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        upload_storage(r->scene_materials_ssbo,
+                       (GLsizeiptr)scene_material_count(s) * 4 * (GLsizeiptr)sizeof(float), scene_materials(s));
+        upload_storage(r->scene_objects_ssbo, objects_size, scene_objects(s));
+        r->scene_objects_capacity = objects_size;
+        r->uploaded_scene = s;
+        r->uploaded_version = scene_structure_version(s);
+        r->history_valid = false;
+        r->accum_samples = 0;
+    } else {
+        /* Only transforms moved: patch the dirty object range in place */
+        int begin, end;
+        scene_dirty_objects(s, &begin, &end);
+        if (begin < end) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->scene_objects_ssbo);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                            (GLintptr)begin * (GLintptr)sizeof(gpu_scene_object),
+                            (GLsizeiptr)(end - begin) * (GLsizeiptr)sizeof(gpu_scene_object),
+                            scene_objects(s) + begin);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            r->history_valid = false;
+            r->accum_samples = 0;
+        }
+    }
+
+    /* The hierarchy is small (two nodes per object); send it whole */
+    GLsizeiptr bvh_size = (GLsizeiptr)bvh_count * (GLsizeiptr)sizeof(gpu_bvh_node);
+    if (bvh_count > 0 && bvh_size <= r->scene_bvh_capacity) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->scene_bvh_ssbo);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bvh_size, bvh);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    } else {
+        upload_storage(r->scene_bvh_ssbo, bvh_size, bvh);
+        r->scene_bvh_capacity = bvh_size;
+    }
+
+    scene_clear_dirty(s);
+    r->object_count = bvh_count > 0 ? count : 0;
+    r->dynamic_count = scene_dynamic_object_count(s);
+
+    if (r->cache_wanted && (s != r->cache_scene || scene_static_version(s) != r->cache_static_version))
+        bake_distance_cache(r, s);
+    return true;
+}
+
+void gl_renderer_set_reprojection(gl_renderer *r, bool enabled)
+{
+    if (!r)
+        return;
+    r->reproject_wanted = enabled;
+}
+
+void gl_renderer_set_normals(gl_renderer *r, gl_renderer_normals mode)
+{
+    if (!r)
+        return;
+    if (mode != r->normal_mode)
+        r->accum_samples = 0;
+    r->normal_mode = mode;
+}
+
+void gl_renderer_set_variant(gl_renderer *r, gl_renderer_variant variant)
+{
+    if (!r || variant < 0 || variant >= GL_RENDERER_VARIANT_COUNT || variant == r->variant)
+        return;
+    r->variant = variant;
+    /* The variants stop rays at different thresholds and distances */
+    r->history_valid = false;
+    r->accum_samples = 0;
+}
+
+void gl_renderer_set_march(gl_renderer *r, gl_renderer_march mode)
+{
+    if (!r)
+        return;
+    if (mode != r->march_mode)
+        r->accum_samples = 0;
+    r->march_mode = mode;
+}
+
+void gl_renderer_set_cost_view(gl_renderer *r, gl_renderer_cost_view view)
+{
+    if (!r || view < GL_RENDERER_COST_OFF || view > GL_RENDERER_COST_TOTAL)
+        return;
+    r->cost_view = view;
+}
+
+void gl_renderer_set_accumulation(gl_renderer *r, bool enabled)
+{
+    if (!r)
+        return;
+    r->accumulate_wanted = enabled;
+    r->accum_samples = 0;
+}
+
+int gl_renderer_accumulated_samples(const gl_renderer *r)
+{
+    return r && r->accumulate_wanted ? r->accum_samples : 0;
+}
+
+void gl_renderer_set_edge_aa(gl_renderer *r, bool enabled)
+{
+    if (!r)
+        return;
+    r->edge_aa_wanted = enabled;
+}
+
+void gl_renderer_set_cone_prepass(gl_renderer *r, bool enabled)
+{
+    if (!r)
+        return;
+    r->cone_wanted = enabled;
 }
 
-static GLuint link_program(GLuint vert, GLuint frag)
+void gl_renderer_set_distance_cache(gl_renderer *r, bool enabled)
 {
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vert);
-    glAttachShader(prog, frag);
-    glLinkProgram(prog);
-
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    GLint success;
-    glGetProgramiv(prog, GL_LINK_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetProgramInfoLog(prog, sizeof(log), NULL, log);
-        fprintf(stderr, "gl_renderer: program link failed:\n%s\n", log);
-        glDeleteProgram(prog);
-        return 0;
-    }
-
-    return prog;
+    if (!r || !r->ok)
+        return;
+    r->cache_wanted = enabled;
+    if (enabled && r->uploaded_scene)
+        gl_renderer_set_scene(r, r->uploaded_scene);
 }
 
-static GLuint link_compute_program(GLuint comp)
+static bool create_scene_buffers(struct gl_renderer *r)
 {
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, comp);
-    glLinkProgram(prog);
+    glGenBuffers(1, &r->scene_nodes_ubo);
+    glGenBuffers(1, &r->scene_objects_ssbo);
+    glGenBuffers(1, &r->scene_materials_ssbo);
+    glGenBuffers(1, &r->scene_bvh_ssbo);
 
-    glDeleteShader(comp);
+    /* Always the full block size, so no read can fall outside the range */
+    glBindBuffer(GL_UNIFORM_BUFFER, r->scene_nodes_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, r->max_nodes * (GLsizeiptr)sizeof(gpu_scene_node), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    GLint success;
-    glGetProgramiv(prog, GL_LINK_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetProgramInfoLog(prog, sizeof(log), NULL, log);
-        fprintf(stderr, "gl_renderer: compute program link failed:\n%s\n", log);
-        glDeleteProgram(prog);
-        return 0;
+    r->default_scene = scene_create();
+    if (!r->default_scene || !scene_build_default(r->default_scene)) {
+        fprintf(stderr, "gl_renderer: failed to build default scene\n");
+        return false;
     }
-
-    return prog;
+    return true;
 }
 
-static void create_output_texture(struct gl_renderer *r)
+static void destroy_scene_buffers(struct gl_renderer *r)
 {
-    if (r->output_texture)
-        glDeleteTextures(1, &r->output_texture);
-
-    glGenTextures(1, &r->output_texture);
-    glBindTexture(GL_TEXTURE_2D, r->output_texture);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, r->width, r->height);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    if (r->scene_nodes_ubo)
+        glDeleteBuffers(1, &r->scene_nodes_ubo);
+    if (r->scene_objects_ssbo)
+        glDeleteBuffers(1, &r->scene_objects_ssbo);
+    if (r->scene_materials_ssbo)
+        glDeleteBuffers(1, &r->scene_materials_ssbo);
+    if (r->scene_bvh_ssbo)
+        glDeleteBuffers(1, &r->scene_bvh_ssbo);
+    scene_destroy(r->default_scene);
 }
 
 gl_renderer *gl_renderer_create(int width, int height)
@@ -158,36 +1631,66 @@ gl_renderer *gl_renderer_create(int width, int height)
     r->width = width;
     r->height = height;
 
-    /* Compute shader for raymarching */
-    GLuint comp = compile_shader(GL_COMPUTE_SHADER, "shaders/raymarch.comp");
-    if (!comp) {
-        free(r);
-        return NULL;
-    }
+    init_program_cache(r);
 
-    r->compute_program = link_compute_program(comp);
-    if (!r->compute_program) {
-        free(r);
-        return NULL;
-    }
+    /* The node table is a uniform block, so it can only be as large as the
+       driver allows; the shaders are built with the clamped size */
+    GLint max_block = 0;
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_block);
+    r->max_nodes = SCENE_MAX_NODES;
+    if (max_block > 0 && max_block / (GLint)sizeof(gpu_scene_node) < r->max_nodes)
+        r->max_nodes = max_block / (GLint)sizeof(gpu_scene_node);
+
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xffffffffu);
 
-    /* Display pass: fullscreen quad samples compute output */
-    GLuint vert = compile_shader(GL_VERTEX_SHADER, "shaders/display.vert");
-    GLuint frag = compile_shader(GL_FRAGMENT_SHADER, "shaders/display.frag");
-    if (!vert || !frag) {
-        glDeleteProgram(r->compute_program);
+    /* Compute shader for raymarching, and the display pass: a fullscreen
+       quad that samples compute output */
+    program_set programs;
+    build_programs(r, &programs, PROGRAMS_ALL);
+    if (!install_programs(r, &programs, PROGRAMS_ALL)) {
+        free(r->program_cache_dir);
         free(r);
         return NULL;
     }
 
-    r->display_program = link_program(vert, frag);
-    if (!r->display_program) {
-        glDeleteProgram(r->compute_program);
-        free(r);
-        return NULL;
+    /* Without the bake programs everything still renders, just uncached */
+    if (!r->programs.prog[PROGRAM_BAKE_COARSE])
+        fprintf(stderr, "gl_renderer: distance cache unavailable\n");
+
+    /* Likewise the cone pre-pass only saves steps */
+    if (!r->programs.prog[PROGRAM_CONE])
+        fprintf(stderr, "gl_renderer: cone pre-pass unavailable\n");
+    r->cone_wanted = true;
+
+    /* And edge anti-aliasing only improves edges; it is opt-in, as its
+       rays cost far more than the share of pixels they cover */
+    if (!r->programs.prog[PROGRAM_EDGE])
+        fprintf(stderr, "gl_renderer: edge anti-aliasing unavailable\n");
+
+    for (int i = 0; i < GL_RENDERER_VARIANT_COUNT; i++) {
+        if (!r->programs.prog[variant_programs[i]])
+            fprintf(stderr, "gl_renderer: %s variant unavailable, using medium\n", variant_names[i]);
     }
 
     create_output_texture(r);
+    create_frame_ring(r);
+    create_march_stats(r);
+    r->march_mode = GL_RENDERER_MARCH_RELAXED_FOOTPRINT;
+    r->render_scale = 1.0f;
+    r->render_width = width;
+    r->render_height = height;
+    r->output_width = width;
+    r->output_height = height;
+    r->image_size[0] = width;
+    r->image_size[1] = height;
+    r->timer_queries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (r->timer_queries)
+        glGenQueries(TIMER_RING_SIZE * TIMER_STAMPS, r->timer_query[0]);
+    if (!create_scene_buffers(r)) {
+        gl_renderer_destroy(r);
+        return NULL;
+    }
 
     /* Fullscreen quad: two triangles, NDC coordinates */
     float vertices[] = {
@@ -208,9 +1711,282 @@ gl_renderer *gl_renderer_create(int width, int height)
     glBindVertexArray(0);
 
     r->ok = true;
+    if (!gl_renderer_set_scene(r, r->default_scene)) {
+        gl_renderer_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+static const EGLint egl_context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+};
+
+/* Bring up an EGL context with no window. Prefers Mesa's surfaceless platform
+   (works on llvmpipe with no display server); falls back to a 1x1 pbuffer on
+   the default display for drivers without it. */
+static bool create_egl_context(EGLDisplay *out_display, EGLContext *out_context, EGLSurface *out_surface)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLSurface surface = EGL_NO_SURFACE;
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+            fprintf(stderr, "gl_renderer: no EGL display available\n");
+            return false;
+        }
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "gl_renderer: EGL has no desktop OpenGL support\n");
+        eglTerminate(display);
+        return false;
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = NULL;
+    EGLint num_configs = 0;
+    eglChooseConfig(display, config_attribs, &config, 1, &num_configs);
+
+    EGLContext context = eglCreateContext(display, num_configs > 0 ? config : (EGLConfig)0,
+                                          EGL_NO_CONTEXT, egl_context_attribs);
+    if (context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "gl_renderer: failed to create EGL 4.3 core context (0x%x)\n", eglGetError());
+        eglTerminate(display);
+        return false;
+    }
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        /* No EGL_KHR_surfaceless_context: bind a throwaway pbuffer instead */
+        const EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        if (num_configs > 0)
+            surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+        if (surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context)) {
+            fprintf(stderr, "gl_renderer: failed to make EGL context current (0x%x)\n", eglGetError());
+            if (surface != EGL_NO_SURFACE)
+                eglDestroySurface(display, surface);
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+            return false;
+        }
+    }
+
+    *out_display = display;
+    *out_context = context;
+    *out_surface = surface;
+    return true;
+}
+
+static void destroy_egl_context(EGLDisplay display, EGLContext context, EGLSurface surface)
+{
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE)
+        eglDestroySurface(display, surface);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+
+gl_renderer *gl_renderer_create_headless(int width, int height)
+{
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface;
+    if (!create_egl_context(&display, &context, &surface))
+        return NULL;
+
+    /* GLEW built against GLX reports NO_GLX_DISPLAY under EGL, but the GL
+       entry points it loaded are still valid. */
+    glewExperimental = GL_TRUE;
+    GLenum glew_err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (glew_err == GLEW_ERROR_NO_GLX_DISPLAY)
+        glew_err = GLEW_OK;
+#endif
+    if (glew_err != GLEW_OK) {
+        fprintf(stderr, "gl_renderer: GLEW init failed: %s\n", glewGetErrorString(glew_err));
+        destroy_egl_context(display, context, surface);
+        return NULL;
+    }
+
+    gl_renderer *r = gl_renderer_create(width, height);
+    if (!r) {
+        destroy_egl_context(display, context, surface);
+        return NULL;
+    }
+
+    r->headless = true;
+    r->egl_display = display;
+    r->egl_context = context;
+    r->egl_surface = surface;
+    fprintf(stderr, "gl_renderer: headless context on %s\n", (const char *)glGetString(GL_RENDERER));
     return r;
 }
 
+/* ---- Asynchronous reload ----
+   A worker thread builds a new program_set on its own context, which
+   shares objects with the renderer's. The context is created on the first
+   asynchronous reload and kept: in a window, on a hidden 1x1 window of its
+   own; headless, as a second surfaceless EGL context. The old programs
+   keep rendering until the worker finishes, and the finished set is
+   installed at the start of the next draw. Only the programs asked for
+   are rebuilt; requests during a build are merged and run after it. */
+
+/* Called on the renderer's thread with its context current; leaves it
+   current. Returns false when no shared context can be made. */
+static bool create_reload_context(struct gl_renderer *r)
+{
+    if (r->headless) {
+        /* The pbuffer fallback has no surfaceless binding for a second context */
+        if (r->egl_surface != EGL_NO_SURFACE)
+            return false;
+        EGLint config_id = 0;
+        eglQueryContext(r->egl_display, r->egl_context, EGL_CONFIG_ID, &config_id);
+        const EGLint config_attribs[] = { EGL_CONFIG_ID, config_id, EGL_NONE };
+        EGLConfig config = NULL;
+        EGLint num_configs = 0;
+        eglChooseConfig(r->egl_display, config_attribs, &config, 1, &num_configs);
+        r->reload_egl_context = eglCreateContext(r->egl_display, num_configs > 0 ? config : (EGLConfig)0,
+                                                 r->egl_context, egl_context_attribs);
+        return r->reload_egl_context != EGL_NO_CONTEXT;
+    }
+
+    SDL_Window *window = SDL_GL_GetCurrentWindow();
+    SDL_GLContext context = SDL_GL_GetCurrentContext();
+    if (!window || !context)
+        return false;
+    r->reload_window = SDL_CreateWindow("forge-reload", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!r->reload_window)
+        return false;
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    r->reload_gl_context = SDL_GL_CreateContext(r->reload_window);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+    /* Creating a context makes it current; give the renderer its own back */
+    SDL_GL_MakeCurrent(window, context);
+    if (!r->reload_gl_context) {
+        SDL_DestroyWindow(r->reload_window);
+        r->reload_window = NULL;
+        return false;
+    }
+    return true;
+}
+
+static int reload_worker(void *data)
+{
+    struct gl_renderer *r = data;
+    bool current;
+    if (r->headless)
+        current = eglBindAPI(EGL_OPENGL_API) &&
+                  eglMakeCurrent(r->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, r->reload_egl_context);
+    else
+        current = SDL_GL_MakeCurrent(r->reload_window, r->reload_gl_context) == 0;
+
+    if (current) {
+        if (GLEW_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xffffffffu);
+        build_programs(r, &r->reload_programs, r->reload_mask);
+        /* Objects are only guaranteed complete in other contexts once the
+           commands that made them have finished */
+        glFinish();
+        if (r->headless)
+            eglMakeCurrent(r->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        else
+            SDL_GL_MakeCurrent(r->reload_window, NULL);
+    } else {
+        fprintf(stderr, "gl_renderer: reload context could not be made current\n");
+    }
+    SDL_AtomicSet(&r->reload_done, 1);
+    return 0;
+}
+
+static void destroy_reload_worker(struct gl_renderer *r)
+{
+    if (r->reload_thread) {
+        SDL_WaitThread(r->reload_thread, NULL);
+        r->reload_thread = NULL;
+        delete_programs(&r->reload_programs);
+    }
+    if (r->reload_gl_context)
+        SDL_GL_DeleteContext(r->reload_gl_context);
+    if (r->reload_window)
+        SDL_DestroyWindow(r->reload_window);
+    if (r->reload_egl_context != EGL_NO_CONTEXT)
+        eglDestroyContext(r->egl_display, r->reload_egl_context);
+    r->reload_gl_context = NULL;
+    r->reload_window = NULL;
+    r->reload_egl_context = EGL_NO_CONTEXT;
+}
+
+/* Rebuild the programs in mask on the calling thread */
+static bool reload_programs_now(struct gl_renderer *r, unsigned mask)
+{
+    program_set programs;
+    build_programs(r, &programs, mask);
+    if (!install_programs(r, &programs, mask)) {
+        fprintf(stderr, "gl_renderer: shader reload failed, keeping the old shaders\n");
+        return false;
+    }
+    fprintf(stderr, "Shaders reloaded successfully.\n");
+    return true;
+}
+
+/* Rebuild the programs in mask on the worker, or queue them behind the
+   build in progress. Without a shared context, rebuilds them now. */
+static bool start_reload(struct gl_renderer *r, unsigned mask)
+{
+    if (r->reload_thread) {
+        r->reload_queued |= mask;
+        return true;
+    }
+    if (!r->reload_context_ready) {
+        if (!create_reload_context(r)) {
+            fprintf(stderr, "gl_renderer: no shared context for background reloads\n");
+            destroy_reload_worker(r);
+            r->reload_sync_only = true;
+        }
+        r->reload_context_ready = true;
+    }
+    if (!r->reload_sync_only) {
+        r->reload_mask = mask;
+        SDL_AtomicSet(&r->reload_done, 0);
+        r->reload_thread = SDL_CreateThread(reload_worker, "forge-reload", r);
+        if (r->reload_thread)
+            return true;
+    }
+    return reload_programs_now(r, mask);
+}
+
+/* At a frame boundary: install the worker's programs once it is done, then
+   start on whatever changed meanwhile */
+static void poll_reload(struct gl_renderer *r)
+{
+    if (!r->reload_thread || !SDL_AtomicGet(&r->reload_done))
+        return;
+    SDL_WaitThread(r->reload_thread, NULL);
+    r->reload_thread = NULL;
+    if (install_programs(r, &r->reload_programs, r->reload_mask))
+        fprintf(stderr, "Shaders reloaded successfully.\n");
+    else
+        fprintf(stderr, "gl_renderer: shader reload failed, keeping the old shaders\n");
+
+    unsigned queued = r->reload_queued;
+    r->reload_queued = 0;
+    if (queued)
+        start_reload(r, queued);
+}
+
 void gl_renderer_destroy(gl_renderer *r)
 {
     if (!r)
@@ -221,45 +1997,63 @@ void gl_renderer_destroy(gl_renderer *r)
         glDeleteBuffers(1, &r->vbo);
     if (r->output_texture)
         glDeleteTextures(1, &r->output_texture);
-    if (r->compute_program)
-        glDeleteProgram(r->compute_program);
-    if (r->display_program)
-        glDeleteProgram(r->display_program);
+    if (r->depth[0])
+        glDeleteTextures(2, r->depth);
+    if (r->tile_start)
+        glDeleteTextures(1, &r->tile_start);
+    if (r->cost_texture)
+        glDeleteTextures(1, &r->cost_texture);
+    if (r->accum_texture)
+        glDeleteTextures(1, &r->accum_texture);
+    if (r->edge_info)
+        glDeleteTextures(1, &r->edge_info);
+    if (r->edge_buffer)
+        glDeleteBuffers(1, &r->edge_buffer);
+    destroy_reload_worker(r);
+    delete_programs(&r->programs);
+    destroy_frame_ring(r);
+    destroy_march_stats(r);
+    destroy_scene_buffers(r);
+    if (r->timer_queries)
+        glDeleteQueries(TIMER_RING_SIZE * TIMER_STAMPS, r->timer_query[0]);
+    if (r->cache_atlas)
+        glDeleteTextures(1, &r->cache_atlas);
+    if (r->cache_coarse)
+        glDeleteTextures(1, &r->cache_coarse);
+    if (r->headless)
+        destroy_egl_context(r->egl_display, r->egl_context, r->egl_surface);
+    free(r->program_cache_dir);
     free(r);
 }
 
-void gl_renderer_draw(gl_renderer *r, float time_s, const camera_t *cam)
+/* Fullscreen quad stretches the bottom-left width x height of
+   output_texture (or with show_cost, the cost heatmap) over the default
+   framebuffer */
+static void display_pass(struct gl_renderer *r, int width, int height, bool show_cost)
 {
-    if (!r || !r->ok)
+    /* Headless has no default framebuffer; the result stays in output_texture */
+    if (r->headless)
         return;
 
-    /* Compute pass: raymarch into output texture */
-    glUseProgram(r->compute_program);
-    glUniform2f(glGetUniformLocation(r->compute_program, "u_resolution"),
-                (float)r->width, (float)r->height);
-    glUniform1f(glGetUniformLocation(r->compute_program, "u_time"), time_s);
-
-    if (cam) {
-        float fwd[3], right[3], up[3];
-        camera_basis(cam, fwd, right, up);
-        glUniform3fv(glGetUniformLocation(r->compute_program, "u_camera_pos"), 1, cam->pos);
-        glUniform3fv(glGetUniformLocation(r->compute_program, "u_camera_forward"), 1, fwd);
-        glUniform3fv(glGetUniformLocation(r->compute_program, "u_camera_right"), 1, right);
-        glUniform3fv(glGetUniformLocation(r->compute_program, "u_camera_up"), 1, up);
-    }
-
-    glBindImageTexture(0, r->output_texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-    glDispatchCompute((r->width + 7) / 8, (r->height + 7) / 8, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-    /* Display pass: fullscreen quad samples output */
     glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(r->display_program);
+    glUseProgram(r->programs.prog[PROGRAM_DISPLAY]);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, r->output_texture);
-    glUniform1i(glGetUniformLocation(r->display_program, "u_image"), 0);
+    glUniform1i(r->display_loc.image, 0);
+    int view = show_cost && r->cost_texture ? (int)r->cost_view : GL_RENDERER_COST_OFF;
+    glActiveTexture(GL_TEXTURE0 + COST_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, view ? r->cost_texture : 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(r->display_loc.cost, COST_TEXTURE_UNIT);
+    glUniform1i(r->display_loc.cost_view, view);
+    glUniform1f(r->display_loc.cost_max, cost_view_max[view]);
+    /* Clamp half a texel inside the rendered area so bilinear filtering
+       never blends in stale texels beyond it */
+    glUniform2f(r->display_loc.uv_scale, (float)width / (float)r->width, (float)height / (float)r->height);
+    glUniform2f(r->display_loc.uv_max, ((float)width - 0.5f) / (float)r->width,
+                ((float)height - 0.5f) / (float)r->height);
 
     glViewport(0, 0, r->width, r->height);
     glBindVertexArray(r->vao);
@@ -267,6 +2061,322 @@ void gl_renderer_draw(gl_renderer *r, float time_s, const camera_t *cam)
     glBindVertexArray(0);
 }
 
+/* Render size for the current scale, at least 8x8 where the window
+   allows. Both sides scale exactly, keeping the aspect ratio; the
+   dispatches round up and the shaders skip pixels past the edge. */
+static void apply_render_scale(struct gl_renderer *r)
+{
+    int w = (int)((float)r->width * r->render_scale + 0.5f);
+    int h = (int)((float)r->height * r->render_scale + 0.5f);
+    r->render_width = w < 8 ? (r->width < 8 ? r->width : 8) : w;
+    r->render_height = h < 8 ? (r->height < 8 ? r->height : 8) : h;
+    if (r->render_scale >= 1.0f) {
+        r->render_width = r->width;
+        r->render_height = r->height;
+    }
+}
+
+/* Fold one frame time, taken at pixels, into the smoothed estimate */
+static void add_frame_time(struct gl_renderer *r, double ms, int pixels)
+{
+    if (pixels <= 0)
+        return;
+    float scaled = (float)(ms * (double)(r->render_width * r->render_height) / (double)pixels);
+    r->frame_ms = r->frame_ms > 0.0f ? r->frame_ms + RENDER_TIMER_SMOOTHING * (scaled - r->frame_ms)
+                                     : scaled;
+}
+
+/* Read back every finished timestamp slot, oldest first, stopping at the
+   first one the GPU has not reached yet. */
+static void collect_timer_queries(struct gl_renderer *r)
+{
+    for (int i = 0; i < TIMER_RING_SIZE; i++) {
+        int slot = (r->timer_slot + i) % TIMER_RING_SIZE;
+        if (!r->timer_pixels[slot])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(r->timer_query[slot][TIMER_DISPLAY_END], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 stamps[TIMER_STAMPS];
+        for (int j = 0; j < TIMER_STAMPS; j++)
+            glGetQueryObjectui64v(r->timer_query[slot][j], GL_QUERY_RESULT, &stamps[j]);
+        double compute_ms = (double)(stamps[TIMER_COMPUTE_END] - stamps[TIMER_COMPUTE_BEGIN]) / 1e6;
+        double display_ms = (double)(stamps[TIMER_DISPLAY_END] - stamps[TIMER_COMPUTE_END]) / 1e6;
+        push_history(&r->compute_history, (float)compute_ms);
+        push_history(&r->display_history, (float)display_ms);
+        add_frame_time(r, compute_ms, r->timer_pixels[slot]);
+        r->timer_pixels[slot] = 0;
+    }
+}
+
+static bool camera_equal(const camera_t *a, const camera_t *b)
+{
+    return a->pos[0] == b->pos[0] && a->pos[1] == b->pos[1] && a->pos[2] == b->pos[2] && a->yaw == b->yaw &&
+           a->pitch == b->pitch;
+}
+
+/* Move the render scale toward target_ms from the latest measurements.
+   Cost is roughly proportional to pixel count, so the scale that would
+   hit the target is the current one times sqrt(target / measured). */
+static void update_render_scale(struct gl_renderer *r, const camera_t *cam)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (r->timer_queries) {
+        collect_timer_queries(r);
+    } else if (r->last_draw_ticks) {
+        double ms = (double)(now - r->last_draw_ticks) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+        add_frame_time(r, ms, r->last_draw_pixels);
+    }
+    r->last_draw_ticks = now;
+    r->last_draw_pixels = r->render_width * r->render_height;
+
+    /* Accumulating with the camera still: any size change would restart
+       the sum, so finish it at full size and hold there; the budget only
+       applies again once the camera moves */
+    if (r->accumulate_wanted && r->accum_samples > 0 && camera_equal(cam, &r->accum_camera)) {
+        if (r->render_scale < 1.0f) {
+            r->render_scale = 1.0f;
+            apply_render_scale(r);
+        }
+        return;
+    }
+
+    if (r->target_ms <= 0.0f || r->frame_ms <= 0.0f)
+        return;
+    float ratio = r->target_ms / r->frame_ms;
+    if (fabsf(ratio - 1.0f) < RENDER_SCALE_DEADBAND)
+        return;
+    float change = sqrtf(ratio);
+    if (change < RENDER_SCALE_MAX_DROP)
+        change = RENDER_SCALE_MAX_DROP;
+    if (change > RENDER_SCALE_MAX_RISE)
+        change = RENDER_SCALE_MAX_RISE;
+    float scale = r->render_scale * change;
+    r->render_scale = scale < RENDER_SCALE_MIN ? RENDER_SCALE_MIN : scale > 1.0f ? 1.0f : scale;
+    apply_render_scale(r);
+}
+
+/* After the raymarch: list the pixels at edges, then re-sample them with
+   a second dispatch of the same raymarch program, sized on the GPU from
+   the list, and copy the count into this frame's statistics */
+static void edge_aa_pass(struct gl_renderer *r, GLuint march)
+{
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glBindImageTexture(DEPTH_OUT_UNIT, r->depth[r->depth_current], 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glUseProgram(r->programs.prog[PROGRAM_EDGE]);
+    glDispatchCompute((r->render_width + 7) / 8, (r->render_height + 7) / 8, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glUseProgram(march);
+    glUniform1i(EDGE_PASS_LOCATION, 1);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, r->edge_buffer);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, r->edge_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, r->march_stats_buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, EDGE_COUNT_OFFSET,
+                        r->march_stats_stride * r->march_stats_slot + (GLintptr)offsetof(march_stats, edge_pixels),
+                        sizeof(GLuint));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/* Cone pre-pass and raymarch of one render_width x render_height frame
+   into output_texture; stamps, if not NULL, receive the compute pass's
+   timestamps */
+static void raymarch_frame(struct gl_renderer *r, float time_s, const camera_t *cam, GLuint *stamps)
+{
+    /* A different view starts the accumulated sum over */
+    if (r->accumulate_wanted) {
+        int view[6] = { r->render_width, r->render_height, r->tile_origin[0], r->tile_origin[1],
+                        r->image_size[0], r->image_size[1] };
+        if (memcmp(view, r->accum_view, sizeof(view)) != 0 || !camera_equal(cam, &r->accum_camera)) {
+            r->accum_samples = 0;
+            memcpy(r->accum_view, view, sizeof(view));
+            r->accum_camera = *cam;
+        }
+        if (!r->accum_texture)
+            create_accum_texture(r);
+    }
+
+    upload_frame_data(r, time_s, cam);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, SCENE_NODES_BINDING, r->scene_nodes_ubo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_OBJECTS_BINDING, r->scene_objects_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_MATERIALS_BINDING, r->scene_materials_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_BVH_BINDING, r->scene_bvh_ssbo);
+    glActiveTexture(GL_TEXTURE0 + SDF_CACHE_ATLAS_UNIT);
+    glBindTexture(GL_TEXTURE_3D, r->cache_atlas);
+    glActiveTexture(GL_TEXTURE0 + SDF_CACHE_COARSE_UNIT);
+    glBindTexture(GL_TEXTURE_3D, r->cache_coarse);
+    glActiveTexture(GL_TEXTURE0);
+    glBindImageTexture(0, r->output_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+    glBindImageTexture(DEPTH_PREV_UNIT, r->depth[1 - r->depth_current], 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(DEPTH_OUT_UNIT, r->depth[r->depth_current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindImageTexture(TILE_START_UNIT, r->tile_start, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+    if (r->cost_view != GL_RENDERER_COST_OFF) {
+        if (!r->cost_texture)
+            create_cost_texture(r);
+        glBindImageTexture(COST_UNIT, r->cost_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16UI);
+    }
+    if (r->accumulate_wanted)
+        glBindImageTexture(ACCUM_UNIT, r->accum_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    bool edge_aa = edge_aa_active(r);
+    if (edge_aa) {
+        /* No edge pixels yet: zero workgroups of (x, 1, 1), count 0 */
+        static const GLuint edge_header[4] = { 0, 1, 1, 0 };
+        if (!r->edge_info)
+            create_edge_buffers(r);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, r->edge_buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(edge_header), edge_header);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EDGE_PIXELS_BINDING, r->edge_buffer);
+        glBindImageTexture(EDGE_INFO_UNIT, r->edge_info, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    }
+    if (stamps)
+        glQueryCounter(stamps[TIMER_COMPUTE_BEGIN], GL_TIMESTAMP);
+
+    /* Cone pre-pass: a start distance per tile, one invocation each */
+    if (r->cone_wanted && r->programs.prog[PROGRAM_CONE]) {
+        int tiles_x = (r->render_width + CONE_TILE - 1) / CONE_TILE;
+        int tiles_y = (r->render_height + CONE_TILE - 1) / CONE_TILE;
+        glUseProgram(r->programs.prog[PROGRAM_CONE]);
+        glDispatchCompute((tiles_x + 7) / 8, (tiles_y + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    /* Compute pass: raymarch into output texture */
+    GLuint march = r->programs.prog[variant_programs[r->variant]];
+    if (!march)
+        march = r->programs.prog[PROGRAM_COMPUTE];
+    glUseProgram(march);
+    glUniform1i(EDGE_PASS_LOCATION, 0);
+    begin_march_stats(r);
+    glDispatchCompute((r->render_width + 7) / 8, (r->render_height + 7) / 8, 1);
+    if (edge_aa)
+        edge_aa_pass(r, march);
+    if (stamps)
+        glQueryCounter(stamps[TIMER_COMPUTE_END], GL_TIMESTAMP);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    end_march_stats(r);
+    fence_frame_data(r);
+    r->output_width = r->render_width;
+    r->output_height = r->render_height;
+    if (r->accumulate_wanted)
+        r->accum_samples++;
+}
+
+void gl_renderer_draw(gl_renderer *r, float time_s, const camera_t *cam)
+{
+    if (!r || !r->ok)
+        return;
+
+    poll_reload(r);
+
+    camera_t origin_cam = { 0 };
+    if (!cam)
+        cam = &origin_cam;
+    update_render_scale(r, cam);
+    collect_march_stats(r, false);
+
+    r->tile_origin[0] = r->tile_origin[1] = 0;
+    r->image_size[0] = r->render_width;
+    r->image_size[1] = r->render_height;
+    GLuint *stamps = r->timer_queries ? r->timer_query[r->timer_slot] : NULL;
+    raymarch_frame(r, time_s, cam, stamps);
+
+    r->depth_current = 1 - r->depth_current;
+    r->prev_camera = *cam;
+    r->prev_render_width = r->render_width;
+    r->prev_render_height = r->render_height;
+    r->history_valid = true;
+
+    display_pass(r, r->render_width, r->render_height, true);
+    if (r->timer_queries) {
+        glQueryCounter(stamps[TIMER_DISPLAY_END], GL_TIMESTAMP);
+        r->timer_pixels[r->timer_slot] = r->render_width * r->render_height;
+        r->timer_slot = (r->timer_slot + 1) % TIMER_RING_SIZE;
+    }
+}
+
+bool gl_renderer_draw_tile(gl_renderer *r, float time_s, const camera_t *cam, int image_width, int image_height,
+                           int x, int y, int width, int height)
+{
+    if (!r || !r->ok || !cam)
+        return false;
+    if (width < 1 || height < 1 || width > r->width || height > r->height || x < 0 || y < 0 ||
+        x + width > image_width || y + height > image_height) {
+        fprintf(stderr, "gl_renderer: tile %dx%d at %d,%d does not fit\n", width, height, x, y);
+        return false;
+    }
+
+    /* No program swaps or scale changes in the middle of an image, no
+       reprojection (the previous frame is another part of the image) and
+       no edge anti-aliasing (see edge_aa_active) */
+    collect_march_stats(r, false);
+    int render_width = r->render_width, render_height = r->render_height;
+    r->render_width = width;
+    r->render_height = height;
+    r->tile_origin[0] = x;
+    r->tile_origin[1] = y;
+    r->image_size[0] = image_width;
+    r->image_size[1] = image_height;
+    r->history_valid = false;
+    r->drawing_tile = true;
+
+    raymarch_frame(r, time_s, cam, NULL);
+
+    r->drawing_tile = false;
+    r->render_width = render_width;
+    r->render_height = render_height;
+    return true;
+}
+
+void gl_renderer_present(gl_renderer *r, const void *rgba)
+{
+    if (!r || !r->ok || !rgba)
+        return;
+
+    poll_reload(r);
+    glBindTexture(GL_TEXTURE_2D, r->output_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, r->width, r->height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    r->output_width = r->width;
+    r->output_height = r->height;
+
+    display_pass(r, r->width, r->height, false);
+}
+
+bool gl_renderer_read_output(gl_renderer *r, void *rgba)
+{
+    if (!r || !r->ok || !rgba)
+        return false;
+
+    /* glGetTexImage returns the whole texture; the frame is its bottom-left
+       output_width x output_height */
+    int w = r->output_width, h = r->output_height;
+    bool crop = w != r->width || h != r->height;
+    unsigned char *full = crop ? malloc((size_t)r->width * (size_t)r->height * 4) : rgba;
+    if (!full)
+        return false;
+
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, r->output_texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, full);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (crop) {
+        for (int y = 0; y < h; y++)
+            memcpy((unsigned char *)rgba + (size_t)y * w * 4, full + (size_t)y * r->width * 4, (size_t)w * 4);
+        free(full);
+    }
+    return true;
+}
+
 void gl_renderer_resize(gl_renderer *r, int width, int height)
 {
     if (!r)
@@ -274,39 +2384,113 @@ void gl_renderer_resize(gl_renderer *r, int width, int height)
     r->width = width;
     r->height = height;
     create_output_texture(r);
+    apply_render_scale(r);
+    r->output_width = r->render_width;
+    r->output_height = r->render_height;
 }
 
 bool gl_renderer_reload_shaders(gl_renderer *r)
 {
     if (!r || !r->ok)
         return false;
+    return reload_programs_now(r, PROGRAMS_ALL);
+}
 
-    GLuint comp = compile_shader(GL_COMPUTE_SHADER, "shaders/raymarch.comp");
-    if (!comp)
+bool gl_renderer_reload_shaders_async(gl_renderer *r)
+{
+    if (!r || !r->ok)
         return false;
+    return start_reload(r, PROGRAMS_ALL);
+}
 
-    GLuint new_comp = link_compute_program(comp);
-    if (!new_comp)
+bool gl_renderer_reload_changed(gl_renderer *r, const char *const *paths, int count)
+{
+    if (!r || !r->ok)
         return false;
-
-    GLuint vert = compile_shader(GL_VERTEX_SHADER, "shaders/display.vert");
-    GLuint frag = compile_shader(GL_FRAGMENT_SHADER, "shaders/display.frag");
-    if (!vert || !frag) {
-        glDeleteProgram(new_comp);
+    unsigned mask = 0;
+    for (int i = 0; i < count; i++)
+        mask |= programs_using_file(r, paths[i]);
+    if (!mask)
         return false;
+    return start_reload(r, mask);
+}
+
+bool gl_renderer_reload_pending(const gl_renderer *r)
+{
+    return r && r->reload_thread;
+}
+
+void gl_renderer_set_target_frame_time(gl_renderer *r, float target_ms)
+{
+    if (!r)
+        return;
+    r->target_ms = target_ms > 0.0f ? target_ms : 0.0f;
+    if (r->target_ms == 0.0f) {
+        r->render_scale = 1.0f;
+        apply_render_scale(r);
     }
+}
+
+void gl_renderer_render_size(const gl_renderer *r, int *width, int *height)
+{
+    *width = r ? r->render_width : 0;
+    *height = r ? r->render_height : 0;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static void summarize_history(const pass_history *h, gl_pass_stats *out)
+{
+    float sorted[STATS_WINDOW];
+    double sum = 0.0;
+    memcpy(sorted, h->value, sizeof(float) * (size_t)h->count);
+    qsort(sorted, (size_t)h->count, sizeof(float), compare_float);
+    for (int i = 0; i < h->count; i++)
+        sum += sorted[i];
+    /* Nearest rank: the smallest sample at or above 99% of the window */
+    int p99 = (int)ceilf(0.99f * (float)h->count) - 1;
+    out->min_ms = sorted[0];
+    out->avg_ms = (float)(sum / (double)h->count);
+    out->p99_ms = sorted[p99 < 0 ? 0 : p99];
+}
+
+static float history_mean(const pass_history *h)
+{
+    double sum = 0.0;
+    for (int i = 0; i < h->count; i++)
+        sum += h->value[i];
+    return h->count > 0 ? (float)(sum / h->count) : 0.0f;
+}
 
-    GLuint new_disp = link_program(vert, frag);
-    if (!new_disp) {
-        glDeleteProgram(new_comp);
+bool gl_renderer_get_stats(const gl_renderer *r, gl_renderer_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!r || !r->ok || (r->compute_history.count == 0 && r->steps_history.count == 0))
         return false;
+    if (r->compute_history.count > 0) {
+        summarize_history(&r->compute_history, &stats->compute);
+        summarize_history(&r->display_history, &stats->display);
+        stats->frames = r->compute_history.count;
     }
+    stats->steps_per_pixel = history_mean(&r->steps_history);
+    stats->step_frames = r->steps_history.count;
+    stats->shadow_steps_per_pixel = history_mean(&r->shadow_history);
+    stats->ao_samples_per_pixel = history_mean(&r->ao_history);
+    stats->edge_pixel_fraction = history_mean(&r->edge_history);
+    stats->edge_steps_per_pixel = history_mean(&r->edge_steps_history);
+    return true;
+}
 
-    glDeleteProgram(r->compute_program);
-    glDeleteProgram(r->display_program);
-    r->compute_program = new_comp;
-    r->display_program = new_disp;
-    fprintf(stderr, "Shaders reloaded successfully.\n");
+bool gl_renderer_get_cost_histogram(const gl_renderer *r, gl_renderer_cost_histogram *histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+    if (!r || r->histogram.frame_pixels == 0)
+        return false;
+    *histogram = r->histogram;
     return true;
 }
 
@@ -314,3 +2498,13 @@ bool gl_renderer_ok(const gl_renderer *r)
 {
     return r && r->ok;
 }
+
+void gl_renderer_finish(gl_renderer *r)
+{
+    if (!r || !r->ok)
+        return;
+    glFinish();
+    if (r->timer_queries)
+        collect_timer_queries(r);
+    collect_march_stats(r, false);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "scene.h"
+
 #include <stdbool.h>
 
 typedef struct gl_renderer gl_renderer;
@@ -11,20 +13,217 @@ typedef struct {
     float pitch;    /* radians, rotation about X (up/down) */
 } camera_t;
 
+/* Orthonormal view basis for a camera, as passed to the raymarch kernel. */
+void camera_basis(const camera_t *cam, float fwd[3], float right[3], float up[3]);
+
+/* Turn cam, from where it stands, to face target. */
+void camera_look_at(camera_t *cam, const float target[3]);
+
 /* Create and initialize the OpenGL renderer. Returns NULL on failure. */
 gl_renderer *gl_renderer_create(int width, int height);
 
+/* Create a renderer that owns an offscreen EGL context (surfaceless, or a
+   pbuffer fallback), so no SDL window or display server is needed. Draws only
+   run the compute pass; there is no display pass. Returns NULL on failure. */
+gl_renderer *gl_renderer_create_headless(int width, int height);
+
 /* Destroy the renderer and free resources. */
 void gl_renderer_destroy(gl_renderer *r);
 
 /* Draw a frame. Call once per frame. time_s: seconds since program start. */
 void gl_renderer_draw(gl_renderer *r, float time_s, const camera_t *cam);
 
+/* Show an externally rendered RGBA8 frame (width * height, bottom row first)
+   through the display pass, e.g. output from the CPU raymarcher. */
+void gl_renderer_present(gl_renderer *r, const void *rgba);
+
+/* Raymarch one tile of a larger image without displaying it: the width x
+   height pixels at (x, y), from the bottom-left, of an image_width x
+   image_height frame seen by cam. The tile must fit the renderer's size;
+   the image may be any size, so stills far beyond the window are drawn
+   tile by tile, one dispatch each, and read back with
+   gl_renderer_read_output. Tiles are never reprojected, and get no edge
+   anti-aliasing, which would leave seams at their borders; accumulate
+   samples instead. Returns false if the tile does not fit. */
+bool gl_renderer_draw_tile(gl_renderer *r, float time_s, const camera_t *cam, int image_width, int image_height,
+                           int x, int y, int width, int height);
+
+/* Copy the last frame or tile drawn, or frame presented, into rgba: RGBA8
+   at its size (for frames, gl_renderer_render_size), bottom row first.
+   Waits for the GPU, so it is meant for tests and captures, not every
+   frame. */
+bool gl_renderer_read_output(gl_renderer *r, void *rgba);
+
+/* Make s the rendered scene and upload it. Call again after editing s: a
+   structural change re-uploads everything, while moved objects only patch
+   their own records. The renderer starts with the default chess scene.
+   Returns false, keeping the previous scene, if the scene does not fit
+   the GPU node table or its bounding volume hierarchy cannot be built. */
+bool gl_renderer_set_scene(gl_renderer *r, scene *s);
+
+/* Static objects (never moved) are baked into a sparse distance cache that
+   can speed up marching; it is rebaked when they change. Off by default:
+   the bake costs seconds and megabytes up front, and animated scenes
+   gain nothing from it. Enabling it bakes the current scene. */
+void gl_renderer_set_distance_cache(gl_renderer *r, bool enabled);
+
+/* Start each primary ray near the distance the previous frame's rays
+   reached around where it reprojects, instead of at the camera. The
+   skipped span is verified against the current scene, so no surface is
+   passed. Any scene change drops the history for a frame. Off by default:
+   the verification costs about what it saves. */
+void gl_renderer_set_reprojection(gl_renderer *r, bool enabled);
+
+/* Before the raymarch, march one cone per 8x8 tile and start every pixel
+   of the tile where its cone first nears a surface. On by default. */
+void gl_renderer_set_cone_prepass(gl_renderer *r, bool enabled);
+
+/* How surface normals are computed at ray hits. Values must match the
+   NORMALS_* defines in shaders/lighting.glsl. */
+typedef enum {
+    GL_RENDERER_NORMALS_CENTRAL = 0,      /* central differences, 6 scene evaluations */
+    GL_RENDERER_NORMALS_TETRAHEDRAL = 1,  /* tetrahedral differences, 4 scene evaluations */
+    GL_RENDERER_NORMALS_ANALYTIC = 2,     /* BVH lookup of the nearest object, then its gradient */
+} gl_renderer_normals;
+
+void gl_renderer_set_normals(gl_renderer *r, gl_renderer_normals mode);
+
+/* Raymarch kernels specialized at compile time: march step limit, hit
+   threshold, horizon, shadow steps and AO samples are #defines, and each
+   variant is its own program. All of them are built (or loaded from the
+   shader cache) with the renderer, so switching costs nothing. MEDIUM is
+   the default; LOW suits a short frame budget and HIGH stills. */
+typedef enum {
+    GL_RENDERER_VARIANT_MEDIUM = 0,
+    GL_RENDERER_VARIANT_LOW = 1,
+    GL_RENDERER_VARIANT_HIGH = 2,
+    GL_RENDERER_VARIANT_NO_SHADOWS = 3,   /* medium without shadow rays */
+    GL_RENDERER_VARIANT_NO_AO = 4,        /* medium without ambient occlusion */
+    GL_RENDERER_VARIANT_COUNT
+} gl_renderer_variant;
+
+void gl_renderer_set_variant(gl_renderer *r, gl_renderer_variant variant);
+
+/* How primary rays step. Bits, so the two combine; values must match the
+   MARCH_* bits in shaders/raymarch.comp. */
+typedef enum {
+    GL_RENDERER_MARCH_PLAIN = 0,              /* step by the distance, fixed hit threshold */
+    GL_RENDERER_MARCH_RELAXED = 1,            /* over-relaxed steps, backtracking on overshoot */
+    GL_RENDERER_MARCH_FOOTPRINT = 2,          /* hit threshold of half a pixel at the ray's distance */
+    GL_RENDERER_MARCH_RELAXED_FOOTPRINT = 3,  /* both (the default) */
+} gl_renderer_march;
+
+void gl_renderer_set_march(gl_renderer *r, gl_renderer_march mode);
+
+/* Cost debugging: with a view on, the raymarch records every pixel's march
+   steps, shadow steps and AO samples, the display pass shows the chosen
+   one as a heatmap (blue cheap, red expensive) instead of the image, and
+   a histogram of march steps is gathered (gl_renderer_get_cost_histogram). */
+typedef enum {
+    GL_RENDERER_COST_OFF = 0,
+    GL_RENDERER_COST_MARCH = 1,    /* primary ray steps, red at 128 */
+    GL_RENDERER_COST_SHADOW = 2,   /* shadow ray steps, red at 64 */
+    GL_RENDERER_COST_AO = 3,       /* AO samples, red at 8 */
+    GL_RENDERER_COST_TOTAL = 4,    /* all three, red at 200 */
+} gl_renderer_cost_view;
+
+void gl_renderer_set_cost_view(gl_renderer *r, gl_renderer_cost_view view);
+
+/* Progressive accumulation for stills (off by default). Each frame shoots
+   one ray per pixel, as always, but through a jittered point inside the
+   pixel, and adds it to a floating-point running sum; the output is the
+   average. While the camera, the view and everything else that changes
+   the picture stay put, every frame refines the same image towards an
+   anti-aliased one; any change starts it over at one sample. */
+void gl_renderer_set_accumulation(gl_renderer *r, bool enabled);
+
+/* Samples in the current accumulated image; 0 with accumulation off. */
+int gl_renderer_accumulated_samples(const gl_renderer *r);
+
+/* Adaptive edge anti-aliasing. After the raymarch, a pass finds the pixels
+   whose depth, normal or object differs from a neighbour's, and a second
+   dispatch gives only those four more rays each. It is skipped while
+   accumulating. Off by default: the rays sit on silhouettes, where they
+   are several times as costly as an average pixel's. */
+void gl_renderer_set_edge_aa(gl_renderer *r, bool enabled);
+
+/* Pixels of one frame by primary march steps: bin i counts
+   i * GL_RENDERER_COST_BIN_STEPS up to the next bin, and the last bin
+   everything above. */
+#define GL_RENDERER_COST_BINS 32
+#define GL_RENDERER_COST_BIN_STEPS 8
+
+typedef struct {
+    unsigned pixels[GL_RENDERER_COST_BINS];
+    int frame_pixels;   /* pixels in the frame */
+} gl_renderer_cost_histogram;
+
+/* The histogram of the latest frame drawn with a cost view whose counters
+   have been read back (a few frames late, never stalling). Returns false
+   (zeroed) if there is none yet. */
+bool gl_renderer_get_cost_histogram(const gl_renderer *r, gl_renderer_cost_histogram *histogram);
+
+/* Dynamic resolution: with a target above zero, the raymarch resolution is
+   adjusted every frame (down to a quarter per axis) so the measured compute
+   pass time approaches target_ms, and the display pass upscales. Timing
+   uses GL timer queries, or the interval between draws without them.
+   0 (the default) always renders at full resolution. */
+void gl_renderer_set_target_frame_time(gl_renderer *r, float target_ms);
+
+/* Resolution the last frame was raymarched at. */
+void gl_renderer_render_size(const gl_renderer *r, int *width, int *height);
+
 /* Resize the viewport. Call when window is resized. */
 void gl_renderer_resize(gl_renderer *r, int width, int height);
 
 /* Reload shaders from disk. Returns true on success; on failure keeps old shaders. */
 bool gl_renderer_reload_shaders(gl_renderer *r);
 
+/* Reload shaders from disk on a background thread with a shared context,
+   so drawing continues with the old shaders meanwhile. The new ones are
+   swapped in at the start of the first draw after they have all linked;
+   if any required program fails, the old ones stay. A request during a
+   reload is queued to run after it. Falls back to a synchronous reload
+   when no shared context can be created. Returns false if a synchronous
+   reload failed. */
+bool gl_renderer_reload_shaders_async(gl_renderer *r);
+
+/* As gl_renderer_reload_shaders_async, but only relinks the programs built
+   from the given shader files (e.g. "shaders/display.frag"). Returns false
+   if none of them is used. */
+bool gl_renderer_reload_changed(gl_renderer *r, const char *const *paths, int count);
+
+/* True while a background reload is still building. */
+bool gl_renderer_reload_pending(const gl_renderer *r);
+
+/* GPU time of one pass over the last frames, in milliseconds. */
+typedef struct {
+    float min_ms;
+    float avg_ms;
+    float p99_ms;
+} gl_pass_stats;
+
+typedef struct {
+    gl_pass_stats compute;   /* raymarch dispatch */
+    gl_pass_stats display;   /* fullscreen quad (next to nothing when headless) */
+    int frames;              /* frames the timings cover, up to 128 */
+    float steps_per_pixel;   /* primary ray march steps, averaged over step_frames */
+    float shadow_steps_per_pixel;
+    float ao_samples_per_pixel;
+    float edge_pixel_fraction;   /* of pixels re-sampled by edge anti-aliasing */
+    float edge_steps_per_pixel;  /* scene evaluations of the re-sample rays, not in the figures above */
+    int step_frames;
+} gl_renderer_stats;
+
+/* Rolling GPU timings and march step counts of gl_renderer_draw, read a few
+   frames late so they never stall. Timings stay zero (frames 0) when timer
+   queries are unsupported. Returns false (stats zeroed) when no frame has
+   finished yet. */
+bool gl_renderer_get_stats(const gl_renderer *r, gl_renderer_stats *stats);
+
 /* Return true if the renderer is valid. */
 bool gl_renderer_ok(const gl_renderer *r);
+
+/* Block until all submitted GL work has completed. Used to time frames when
+   there is no swap to pace them. */
+void gl_renderer_finish(gl_renderer *r);
@@ -1,4 +1,7 @@
+#include "cpu_renderer.h"
 #include "gl_renderer.h"
+#include "scene.h"
+#include "shader_watch.h"
 
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
@@ -6,13 +9,114 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define WIDTH 1600
 #define HEIGHT 900
 
+/* Windowed frame budget for dynamic resolution; see --target-ms */
+#define TARGET_FRAME_MS 33.3f
+
 #define CAMERA_SPEED 4.0f
 #define MOUSE_SENSITIVITY 0.002f
 
+static const char *const normals_names[] = { "central", "tetrahedral", "analytic" };
+#define NORMALS_COUNT 3
+
+static bool parse_normals(const char *name, gl_renderer_normals *mode)
+{
+    for (int i = 0; i < NORMALS_COUNT; i++)
+    {
+        if (strcmp(name, normals_names[i]) == 0)
+        {
+            *mode = (gl_renderer_normals)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *const variant_names[] = { "medium", "low", "high", "no-shadows", "no-ao" };
+
+static bool parse_variant(const char *name, gl_renderer_variant *variant)
+{
+    for (int i = 0; i < GL_RENDERER_VARIANT_COUNT; i++)
+    {
+        if (strcmp(name, variant_names[i]) == 0)
+        {
+            *variant = (gl_renderer_variant)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *const march_names[] = { "plain", "relaxed", "footprint", "relaxed-footprint" };
+#define MARCH_COUNT 4
+
+static bool parse_march(const char *name, gl_renderer_march *mode)
+{
+    for (int i = 0; i < MARCH_COUNT; i++)
+    {
+        if (strcmp(name, march_names[i]) == 0)
+        {
+            *mode = (gl_renderer_march)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *const cost_names[] = { "off", "march", "shadow", "ao", "total" };
+#define COST_VIEW_COUNT 5
+
+static bool parse_cost_view(const char *name, gl_renderer_cost_view *view)
+{
+    for (int i = 0; i < COST_VIEW_COUNT; i++)
+    {
+        if (strcmp(name, cost_names[i]) == 0)
+        {
+            *view = (gl_renderer_cost_view)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* March steps below which fraction of the frame's pixels stop, to the
+   resolution of the histogram bins */
+static int histogram_percentile(const gl_renderer_cost_histogram *h, float fraction)
+{
+    unsigned long long below = 0;
+    for (int i = 0; i < GL_RENDERER_COST_BINS; i++)
+    {
+        below += h->pixels[i];
+        if ((double)below >= fraction * (double)h->frame_pixels)
+            return (i + 1) * GL_RENDERER_COST_BIN_STEPS;
+    }
+    return GL_RENDERER_COST_BINS * GL_RENDERER_COST_BIN_STEPS;
+}
+
+static void print_cost_histogram(const gl_renderer_cost_histogram *h)
+{
+    printf("March steps per pixel (last frame):\n");
+    for (int i = 0; i < GL_RENDERER_COST_BINS; i++)
+    {
+        if (h->pixels[i] == 0)
+            continue;
+        double share = 100.0 * (double)h->pixels[i] / (double)h->frame_pixels;
+        int lo = i * GL_RENDERER_COST_BIN_STEPS;
+        if (i == GL_RENDERER_COST_BINS - 1)
+            printf("  %3d+    %5.1f%% ", lo, share);
+        else
+            printf("  %3d-%-3d %5.1f%% ", lo, lo + GL_RENDERER_COST_BIN_STEPS - 1, share);
+        for (int j = 0; j < (int)(share / 2.0 + 0.5); j++)
+            putchar('#');
+        putchar('\n');
+    }
+}
+
 static void camera_update(camera_t *cam, float dt, const Uint8 *keys, int mouse_dx, int mouse_dy)
 {
     cam->yaw += (float)mouse_dx * MOUSE_SENSITIVITY;
@@ -42,14 +146,308 @@ static void camera_update(camera_t *cam, float dt, const Uint8 *keys, int mouse_
     }
 }
 
+/* Bob every piece (all objects but the board) up and down, so each frame
+   moves every object transform. base_y holds each object's rest height. */
+static void animate_scene(scene *s, const float *base_y, float time)
+{
+    int count = scene_object_count(s);
+    for (int i = 1; i < count; i++)
+    {
+        float pos[3], yaw, scale;
+        if (!scene_get_object_transform(s, i, pos, &yaw, &scale))
+            continue;
+        pos[1] = base_y[i] + 0.1f * sinf(time * 3.0f + (float)i * 0.7f);
+        scene_set_object_transform(s, i, pos, yaw, scale);
+    }
+}
+
+static float *scene_rest_heights(const scene *s)
+{
+    int count = scene_object_count(s);
+    float *base_y = malloc(sizeof(float) * (size_t)(count > 0 ? count : 1));
+    if (!base_y)
+        return NULL;
+    for (int i = 0; i < count; i++)
+    {
+        float pos[3] = { 0.0f, 0.0f, 0.0f }, yaw, scale;
+        scene_get_object_transform(s, i, pos, &yaw, &scale);
+        base_y[i] = pos[1];
+    }
+    return base_y;
+}
+
+/* Render a fixed number of frames offscreen and report throughput. Time
+   advances by a fixed step so runs are repeatable. With a scene, it replaces
+   the default one; with animate, every object moves each frame and the
+   cost of patching the scene buffers is reported separately. A target
+   frame time enables dynamic resolution, and the average resolution
+   actually rendered is reported. */
+static int run_headless(int width, int height, int frames, scene *scene, bool animate, bool sdf_cache,
+                        bool reproject, bool cone_prepass, float target_ms, gl_renderer_normals normals,
+                        gl_renderer_variant variant, gl_renderer_march march, gl_renderer_cost_view cost_view,
+                        bool accumulate, bool edge_aa)
+{
+    gl_renderer *renderer = gl_renderer_create_headless(width, height);
+    if (!renderer || !gl_renderer_ok(renderer))
+    {
+        fprintf(stderr, "Error: Failed to create headless OpenGL renderer\n");
+        if (renderer)
+            gl_renderer_destroy(renderer);
+        return 1;
+    }
+    gl_renderer_set_reprojection(renderer, reproject);
+    gl_renderer_set_cone_prepass(renderer, cone_prepass);
+    gl_renderer_set_target_frame_time(renderer, target_ms);
+    gl_renderer_set_normals(renderer, normals);
+    gl_renderer_set_variant(renderer, variant);
+    gl_renderer_set_march(renderer, march);
+    gl_renderer_set_cost_view(renderer, cost_view);
+    gl_renderer_set_accumulation(renderer, accumulate);
+    gl_renderer_set_edge_aa(renderer, edge_aa);
+
+    float *base_y = NULL;
+    if (scene)
+    {
+        if (!gl_renderer_set_scene(renderer, scene) ||
+            (animate && !(base_y = scene_rest_heights(scene))))
+        {
+            fprintf(stderr, "Error: Failed to set up scene\n");
+            gl_renderer_destroy(renderer);
+            return 1;
+        }
+        /* The first move turns objects dynamic, which rebakes the
+           distance cache once; keep that out of the timed frames */
+        if (base_y)
+        {
+            animate_scene(scene, base_y, 0.0f);
+            gl_renderer_set_scene(renderer, scene);
+        }
+        printf("Scene: %d objects, %d nodes (%zu + %zu bytes)\n",
+               scene_object_count(scene), scene_node_count(scene),
+               (size_t)scene_object_count(scene) * sizeof(gpu_scene_object),
+               (size_t)scene_node_count(scene) * sizeof(gpu_scene_node));
+    }
+    /* Enabled once the scene is final, so only it is baked */
+    gl_renderer_set_distance_cache(renderer, sdf_cache);
+
+    camera_t camera = { 0 };
+
+    /* Warm-up frame absorbs shader JIT and first-use allocation */
+    gl_renderer_draw(renderer, 0.0f, &camera);
+    gl_renderer_finish(renderer);
+
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 update_ticks = 0;
+    double pixels = 0.0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++)
+    {
+        float time = (float)i / 60.0f;
+        if (base_y)
+        {
+            Uint64 t0 = SDL_GetPerformanceCounter();
+            animate_scene(scene, base_y, time);
+            gl_renderer_set_scene(renderer, scene);
+            update_ticks += SDL_GetPerformanceCounter() - t0;
+        }
+        gl_renderer_draw(renderer, time, &camera);
+        gl_renderer_finish(renderer);
+
+        int render_w, render_h;
+        gl_renderer_render_size(renderer, &render_w, &render_h);
+        pixels += (double)render_w * render_h;
+    }
+    double secs = (double)(SDL_GetPerformanceCounter() - start) / (double)freq;
+
+    double ms = secs * 1000.0 / (double)frames;
+    printf("Headless %dx%d: %d frames, %.3f ms/frame, %.2f FPS, %.2f Mrays/s\n",
+           width, height, frames, ms, 1000.0 / ms, pixels / secs / 1e6);
+    gl_renderer_stats stats;
+    if (gl_renderer_get_stats(renderer, &stats))
+    {
+        if (stats.frames > 0)
+            printf("GPU compute over the last %d frames: min %.3f, avg %.3f, p99 %.3f ms\n",
+                   stats.frames, stats.compute.min_ms, stats.compute.avg_ms, stats.compute.p99_ms);
+        printf("March (%s): %.1f steps/pixel, shadows %.1f steps/pixel, AO %.1f samples/pixel\n",
+               march_names[march], stats.steps_per_pixel, stats.shadow_steps_per_pixel,
+               stats.ao_samples_per_pixel);
+        if (edge_aa && !accumulate)
+            printf("Edge AA: %.1f%% of pixels re-sampled, %.1f steps/pixel\n", stats.edge_pixel_fraction * 100.0f,
+                   stats.edge_steps_per_pixel);
+    }
+    gl_renderer_cost_histogram histogram;
+    if (gl_renderer_get_cost_histogram(renderer, &histogram))
+        print_cost_histogram(&histogram);
+    if (accumulate)
+        printf("Accumulated: %d samples/pixel\n", gl_renderer_accumulated_samples(renderer));
+    if (target_ms > 0.0f)
+        printf("Dynamic resolution: target %.1f ms, average render scale %.2f\n",
+               target_ms, sqrt(pixels / frames / ((double)width * height)));
+    if (base_y)
+        printf("Scene update: %.2f us/frame\n",
+               (double)update_ticks * 1e6 / (double)freq / (double)frames);
+
+    free(base_y);
+    gl_renderer_destroy(renderer);
+    return 0;
+}
+
+/* As run_headless, but on the CPU raymarcher; needs no GL at all. */
+static int run_headless_cpu(int width, int height, int frames, int threads)
+{
+    cpu_renderer *renderer = cpu_renderer_create(width, height, threads);
+    if (!renderer)
+    {
+        fprintf(stderr, "Error: Failed to create CPU renderer\n");
+        return 1;
+    }
+
+    camera_t camera = { 0 };
+    cpu_renderer_draw(renderer, 0.0f, &camera);
+
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++)
+        cpu_renderer_draw(renderer, (float)i / 60.0f, &camera);
+    double secs = (double)(SDL_GetPerformanceCounter() - start) / (double)freq;
+
+    double ms = secs * 1000.0 / (double)frames;
+    printf("Headless CPU %dx%d (%d threads, %d-wide SIMD): %d frames, %.3f ms/frame, %.2f FPS, %.2f Mrays/s\n",
+           width, height, cpu_renderer_threads(renderer), cpu_renderer_simd_width(), frames,
+           ms, 1000.0 / ms, (double)width * height * frames / secs / 1e6);
+
+    cpu_renderer_destroy(renderer);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    bool headless = false;
+    bool cpu = false;
+    int threads = 0;
+    int frames = 100;
+    int width = WIDTH, height = HEIGHT;
+    int pieces = -1;
+    bool animate = false;
+    bool sdf_cache = false;
+    bool reproject = false;
+    bool cone_prepass = true;
+    float target_ms = -1.0f;
+    gl_renderer_normals normals = GL_RENDERER_NORMALS_CENTRAL;
+    bool bench_normals = false;
+    gl_renderer_variant variant = GL_RENDERER_VARIANT_MEDIUM;
+    gl_renderer_march march = GL_RENDERER_MARCH_RELAXED_FOOTPRINT;
+    gl_renderer_cost_view cost_view = GL_RENDERER_COST_OFF;
+    bool accumulate = false;
+    bool edge_aa = false;
+    bool watch_shaders = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--cpu") == 0)
+            cpu = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            sscanf(argv[++i], "%dx%d", &width, &height);
+        else if (strcmp(argv[i], "--pieces") == 0 && i + 1 < argc)
+            pieces = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--animate") == 0)
+            animate = true;
+        else if (strcmp(argv[i], "--sdf-cache") == 0)
+            sdf_cache = true;
+        else if (strcmp(argv[i], "--reprojection") == 0)
+            reproject = true;
+        else if (strcmp(argv[i], "--no-cone-prepass") == 0)
+            cone_prepass = false;
+        else if (strcmp(argv[i], "--target-ms") == 0 && i + 1 < argc)
+            target_ms = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--normals") == 0 && i + 1 < argc && parse_normals(argv[i + 1], &normals))
+            i++;
+        else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc && parse_variant(argv[i + 1], &variant))
+            i++;
+        else if (strcmp(argv[i], "--march") == 0 && i + 1 < argc && parse_march(argv[i + 1], &march))
+            i++;
+        else if (strcmp(argv[i], "--cost-view") == 0 && i + 1 < argc && parse_cost_view(argv[i + 1], &cost_view))
+            i++;
+        else if (strcmp(argv[i], "--accumulate") == 0)
+            accumulate = true;
+        else if (strcmp(argv[i], "--edge-aa") == 0)
+            edge_aa = true;
+        else if (strcmp(argv[i], "--bench-normals") == 0)
+            bench_normals = true;
+        else if (strcmp(argv[i], "--no-watch") == 0)
+            watch_shaders = false;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--headless] [--cpu] [--threads N] [--frames N] [--size WxH]"
+                            " [--pieces N] [--animate] [--sdf-cache] [--reprojection]"
+                            " [--no-cone-prepass] [--target-ms MS] [--normals central|tetrahedral|analytic]"
+                            " [--variant medium|low|high|no-shadows|no-ao]"
+                            " [--march plain|relaxed|footprint|relaxed-footprint]"
+                            " [--cost-view off|march|shadow|ao|total] [--accumulate] [--edge-aa]"
+                            " [--bench-normals] [--no-watch]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1) frames = 1;
+    if (width < 1 || height < 1) { width = WIDTH; height = HEIGHT; }
+
+    if (cpu && (pieces >= 0 || animate))
+    {
+        fprintf(stderr, "Error: --cpu only draws the default scene; it cannot be combined with --pieces or --animate\n");
+        return 1;
+    }
+
+    /* The GPU renderer owns a default scene; --pieces or --animate swap in
+       a board built here, which must outlive the renderer's use of it. */
+    scene *board = NULL;
+    if (!cpu && (pieces >= 0 || animate))
+    {
+        board = scene_create();
+        if (!board || !(pieces >= 0 ? scene_build_board(board, pieces) : scene_build_default(board)))
+        {
+            fprintf(stderr, "Error: Failed to build scene\n");
+            scene_destroy(board);
+            return 1;
+        }
+    }
+
+    /* Same frames once per normal strategy, each on a fresh renderer so
+       the GPU statistics cover that strategy alone */
+    if (bench_normals)
+    {
+        int result = 0;
+        for (int i = 0; i < NORMALS_COUNT && result == 0; i++)
+        {
+            printf("Normals: %s\n", normals_names[i]);
+            result = run_headless(width, height, frames, board, animate, sdf_cache, reproject, cone_prepass,
+                                  target_ms > 0.0f ? target_ms : 0.0f, (gl_renderer_normals)i, variant, march,
+                                  cost_view, accumulate, edge_aa);
+        }
+        scene_destroy(board);
+        return result;
+    }
+
+    if (headless)
+    {
+        int result = cpu ? run_headless_cpu(width, height, frames, threads)
+                         : run_headless(width, height, frames, board, animate, sdf_cache,
+                                        reproject, cone_prepass, target_ms > 0.0f ? target_ms : 0.0f, normals,
+                                        variant, march, cost_view, accumulate, edge_aa);
+        scene_destroy(board);
+        return result;
+    }
 
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
     {
         fprintf(stderr, "Error: Failed to initialise SDL: %s\n", SDL_GetError());
+        scene_destroy(board);
         return 1;
     }
 
@@ -64,7 +462,7 @@ int main(int argc, char **argv)
         "Forge Engine",
         SDL_WINDOWPOS_CENTERED,
         SDL_WINDOWPOS_CENTERED,
-        WIDTH, HEIGHT,
+        width, height,
         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
     );
 
@@ -72,6 +470,7 @@ int main(int argc, char **argv)
     {
         fprintf(stderr, "Error: Failed to open window: %s\n", SDL_GetError());
         SDL_Quit();
+        scene_destroy(board);
         return 1;
     }
 
@@ -81,6 +480,7 @@ int main(int argc, char **argv)
         fprintf(stderr, "Error: Failed to create OpenGL context: %s\n", SDL_GetError());
         SDL_DestroyWindow(window);
         SDL_Quit();
+        scene_destroy(board);
         return 1;
     }
 
@@ -96,10 +496,11 @@ int main(int argc, char **argv)
         SDL_GL_DeleteContext(gl_context);
         SDL_DestroyWindow(window);
         SDL_Quit();
+        scene_destroy(board);
         return 1;
     }
 
-    gl_renderer *renderer = gl_renderer_create(WIDTH, HEIGHT);
+    gl_renderer *renderer = gl_renderer_create(width, height);
     if (!renderer || !gl_renderer_ok(renderer))
     {
         fprintf(stderr, "Error: Failed to create OpenGL renderer\n");
@@ -108,10 +509,59 @@ int main(int argc, char **argv)
         SDL_GL_DeleteContext(gl_context);
         SDL_DestroyWindow(window);
         SDL_Quit();
+        scene_destroy(board);
         return 1;
     }
 
-    glViewport(0, 0, WIDTH, HEIGHT);
+    cpu_renderer *cpu_renderer = NULL;
+    /* False while the CPU framebuffer failed to follow a resize: its
+       frames no longer match the size gl_renderer_present expects */
+    bool cpu_size_ok = true;
+    if (cpu)
+    {
+        cpu_renderer = cpu_renderer_create(width, height, threads);
+        if (!cpu_renderer)
+        {
+            fprintf(stderr, "Error: Failed to create CPU renderer\n");
+            gl_renderer_destroy(renderer);
+            SDL_GL_DeleteContext(gl_context);
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            scene_destroy(board);
+            return 1;
+        }
+    }
+
+    gl_renderer_set_reprojection(renderer, reproject);
+    gl_renderer_set_cone_prepass(renderer, cone_prepass);
+    gl_renderer_set_normals(renderer, normals);
+    gl_renderer_set_variant(renderer, variant);
+    gl_renderer_set_march(renderer, march);
+    gl_renderer_set_cost_view(renderer, cost_view);
+    gl_renderer_set_accumulation(renderer, accumulate);
+    gl_renderer_set_edge_aa(renderer, edge_aa);
+    /* Headless runs render at full size unless asked; the window keeps to
+       a frame budget by default */
+    gl_renderer_set_target_frame_time(renderer, target_ms >= 0.0f ? target_ms : TARGET_FRAME_MS);
+
+    float *base_y = NULL;
+    if (board && (!gl_renderer_set_scene(renderer, board) ||
+                  (animate && !(base_y = scene_rest_heights(board)))))
+    {
+        fprintf(stderr, "Error: Failed to set up scene\n");
+        gl_renderer_destroy(renderer);
+        SDL_GL_DeleteContext(gl_context);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        scene_destroy(board);
+        return 1;
+    }
+    gl_renderer_set_distance_cache(renderer, sdf_cache);
+
+    /* Saved shader edits are picked up without pressing R */
+    shader_watch *watch = watch_shaders ? shader_watch_create("shaders") : NULL;
+
+    glViewport(0, 0, width, height);
 
     camera_t camera = { 0 };
     camera.pos[0] = 0; camera.pos[1] = 0; camera.pos[2] = 0;
@@ -140,7 +590,37 @@ int main(int argc, char **argv)
                     break;
                 case SDL_KEYDOWN:
                     if (e.key.keysym.sym == SDLK_r && !e.key.repeat)
-                        gl_renderer_reload_shaders(renderer);
+                        gl_renderer_reload_shaders_async(renderer);
+                    if (e.key.keysym.sym == SDLK_n && !e.key.repeat)
+                    {
+                        normals = (gl_renderer_normals)((normals + 1) % NORMALS_COUNT);
+                        gl_renderer_set_normals(renderer, normals);
+                        printf("Normals: %s\n", normals_names[normals]);
+                    }
+                    if (e.key.keysym.sym == SDLK_v && !e.key.repeat)
+                    {
+                        variant = (gl_renderer_variant)((variant + 1) % GL_RENDERER_VARIANT_COUNT);
+                        gl_renderer_set_variant(renderer, variant);
+                        printf("Variant: %s\n", variant_names[variant]);
+                    }
+                    if (e.key.keysym.sym == SDLK_c && !e.key.repeat)
+                    {
+                        cost_view = (gl_renderer_cost_view)((cost_view + 1) % COST_VIEW_COUNT);
+                        gl_renderer_set_cost_view(renderer, cost_view);
+                        printf("Cost view: %s\n", cost_names[cost_view]);
+                    }
+                    if (e.key.keysym.sym == SDLK_p && !e.key.repeat)
+                    {
+                        accumulate = !accumulate;
+                        gl_renderer_set_accumulation(renderer, accumulate);
+                        printf("Accumulation: %s\n", accumulate ? "on" : "off");
+                    }
+                    if (e.key.keysym.sym == SDLK_e && !e.key.repeat)
+                    {
+                        edge_aa = !edge_aa;
+                        gl_renderer_set_edge_aa(renderer, edge_aa);
+                        printf("Edge AA: %s\n", edge_aa ? "on" : "off");
+                    }
                     if (e.key.keysym.sym == SDLK_ESCAPE)
                         SDL_SetRelativeMouseMode(SDL_GetRelativeMouseMode() ? SDL_FALSE : SDL_TRUE);
                     break;
@@ -150,11 +630,20 @@ int main(int argc, char **argv)
                     break;
                 case SDL_WINDOWEVENT:
                     if (e.window.event == SDL_WINDOWEVENT_RESIZED)
+                    {
                         gl_renderer_resize(renderer, e.window.data1, e.window.data2);
+                        if (cpu_renderer)
+                            cpu_size_ok = cpu_renderer_resize(cpu_renderer, e.window.data1, e.window.data2);
+                    }
                     break;
             }
         }
 
+        const char *const *changed;
+        int changed_count = shader_watch_poll(watch, &changed);
+        if (changed_count > 0)
+            gl_renderer_reload_changed(renderer, changed, changed_count);
+
         Uint32 now = SDL_GetTicks();
         float dt = (float)(now - last_time) / 1000.0f;
         last_time = now;
@@ -163,19 +652,69 @@ int main(int argc, char **argv)
         const Uint8 *keys = SDL_GetKeyboardState(NULL);
         camera_update(&camera, dt, keys, mouse_dx, mouse_dy);
 
-        gl_renderer_draw(renderer, (float)now / 1000.0f, &camera);
+        if (cpu_renderer)
+        {
+            if (cpu_size_ok)
+            {
+                cpu_renderer_draw(cpu_renderer, (float)now / 1000.0f, &camera);
+                gl_renderer_present(renderer, cpu_renderer_pixels(cpu_renderer));
+            }
+        }
+        else
+        {
+            if (base_y)
+            {
+                animate_scene(board, base_y, (float)now / 1000.0f);
+                gl_renderer_set_scene(renderer, board);
+            }
+            gl_renderer_draw(renderer, (float)now / 1000.0f, &camera);
+        }
         SDL_GL_SwapWindow(window);
 
         frame_count++;
         if (now - last_fps_time >= 1000)
         {
-            printf("FPS: %d\n", frame_count);
+            if (cpu_renderer)
+            {
+                printf("FPS: %d\n", frame_count);
+            }
+            else
+            {
+                /* GPU pass times against the frame interval show whether
+                   time goes to marching, presenting or waiting on vsync */
+                int render_w, render_h;
+                gl_renderer_stats stats;
+                gl_renderer_render_size(renderer, &render_w, &render_h);
+                if (gl_renderer_get_stats(renderer, &stats) && stats.frames > 0)
+                    printf("FPS: %d (rendering %dx%d, %.1f steps/px) | GPU min/avg/p99: compute %.2f/%.2f/%.2f ms,"
+                           " display %.2f/%.2f/%.2f ms\n", frame_count, render_w, render_h, stats.steps_per_pixel,
+                           stats.compute.min_ms, stats.compute.avg_ms, stats.compute.p99_ms,
+                           stats.display.min_ms, stats.display.avg_ms, stats.display.p99_ms);
+                else if (stats.step_frames > 0)
+                    printf("FPS: %d (rendering %dx%d, %.1f steps/px)\n", frame_count, render_w, render_h,
+                           stats.steps_per_pixel);
+                else
+                    printf("FPS: %d (rendering %dx%d)\n", frame_count, render_w, render_h);
+
+                gl_renderer_cost_histogram histogram;
+                if (cost_view != GL_RENDERER_COST_OFF && gl_renderer_get_cost_histogram(renderer, &histogram))
+                    printf("Cost: march steps p50 < %d, p90 < %d, p99 < %d | shadow %.1f steps/px, AO %.1f"
+                           " samples/px\n", histogram_percentile(&histogram, 0.5f),
+                           histogram_percentile(&histogram, 0.9f), histogram_percentile(&histogram, 0.99f),
+                           stats.shadow_steps_per_pixel, stats.ao_samples_per_pixel);
+                if (accumulate)
+                    printf("Accumulated: %d samples/pixel\n", gl_renderer_accumulated_samples(renderer));
+            }
             frame_count = 0;
             last_fps_time = now;
         }
     }
 
+    shader_watch_destroy(watch);
+    cpu_renderer_destroy(cpu_renderer);
     gl_renderer_destroy(renderer);
+    free(base_y);
+    scene_destroy(board);
     SDL_GL_DeleteContext(gl_context);
     SDL_DestroyWindow(window);
     SDL_Quit();
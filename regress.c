@@ -0,0 +1,352 @@
+/* Image regression check: renders the default chess scene headlessly from
+   fixed cameras, reads each frame back and compares it with a golden PNG
+   in golden/, allowing for small colour differences between drivers.
+   Every view is rendered once per renderer configuration, and all of them
+   must match the same golden, which the default configuration draws.
+   Built and run by `make regress`; --update rewrites the goldens. */
+
+#include "gl_renderer.h"
+
+#include <math.h>
+#include <png.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_WIDTH 320
+#define DEFAULT_HEIGHT 180
+#define DEFAULT_MAX_DELTA_E 5.0
+#define DEFAULT_MAX_BAD 0.002
+#define MAX_PATH 512
+
+/* A fixed view of the default scene */
+typedef struct {
+    const char *name;
+    float pos[3];
+    float target[3];
+} view;
+
+static const view views[] = {
+    { "front", { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },
+    { "above", { 3.0f, 2.0f, 0.0f }, { 0.0f, -0.5f, -4.0f } },
+    { "side", { -5.0f, 0.0f, -4.0f }, { 0.0f, -0.5f, -4.0f } },
+    { "close", { 0.6f, -0.3f, -1.8f }, { 0.0f, -0.5f, -3.0f } },
+    { "grazing", { 0.0f, -0.9f, 2.0f }, { 0.0f, -0.9f, -4.0f } },
+};
+#define VIEW_COUNT ((int)(sizeof(views) / sizeof(views[0])))
+
+/* Renderer settings that must not change the picture. With frames above
+   1, the camera comes in sideways from REPROJECT_STEP per frame away, so
+   the last frame, at the view, reprojects from the ones before it.
+   max_bad, when not 0, replaces --max-bad: plain steps run out on rays
+   grazing the board's horizon and the pieces' silhouettes, where the
+   default footprint threshold stops them, which fails about 2% of
+   pixels. */
+typedef struct {
+    const char *name;
+    bool sdf_cache;
+    gl_renderer_march march;
+    int frames;
+    double max_bad;
+} config;
+
+#define REPROJECT_FRAMES 4
+#define REPROJECT_STEP 0.05f
+
+static const config configs[] = {
+    { "default", false, GL_RENDERER_MARCH_RELAXED_FOOTPRINT, 1, 0.0 },
+    { "sdf-cache", true, GL_RENDERER_MARCH_RELAXED_FOOTPRINT, 1, 0.0 },
+    { "plain", false, GL_RENDERER_MARCH_PLAIN, 1, 0.03 },
+    { "reproject", false, GL_RENDERER_MARCH_RELAXED_FOOTPRINT, REPROJECT_FRAMES, 0.0 },
+};
+#define CONFIG_COUNT ((int)(sizeof(configs) / sizeof(configs[0])))
+
+typedef struct {
+    double mean_delta_e;
+    double bad_fraction;    /* pixels beyond max_delta_e of every golden neighbour */
+} diff_result;
+
+/* 8-bit sRGB to CIELAB (D65) */
+static void srgb_to_lab(const unsigned char *c, float lab[3])
+{
+    float lin[3];
+    for (int i = 0; i < 3; i++)
+    {
+        float v = c[i] / 255.0f;
+        lin[i] = v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+    }
+    float xyz[3] = {
+        (0.4124f * lin[0] + 0.3576f * lin[1] + 0.1805f * lin[2]) / 0.95047f,
+        0.2126f * lin[0] + 0.7152f * lin[1] + 0.0722f * lin[2],
+        (0.0193f * lin[0] + 0.1192f * lin[1] + 0.9505f * lin[2]) / 1.08883f,
+    };
+    for (int i = 0; i < 3; i++)
+        xyz[i] = xyz[i] > 0.008856f ? cbrtf(xyz[i]) : 7.787f * xyz[i] + 16.0f / 116.0f;
+    lab[0] = 116.0f * xyz[1] - 16.0f;
+    lab[1] = 500.0f * (xyz[0] - xyz[1]);
+    lab[2] = 200.0f * (xyz[1] - xyz[2]);
+}
+
+static float delta_e(const float a[3], const float b[3])
+{
+    float dl = a[0] - b[0], da = a[1] - b[1], db = a[2] - b[2];
+    return sqrtf(dl * dl + da * da + db * db);
+}
+
+/* Compare actual with golden, both RGBA8 top row first. Each pixel is
+   matched against the closest colour in the 3x3 golden neighbourhood, so an
+   edge that moved by a pixel does not count. If diff is not NULL it
+   receives the golden dimmed to grey with the failing pixels in red. */
+static diff_result compare_images(const unsigned char *actual, const unsigned char *golden, int width, int height,
+                                  double max_delta_e, unsigned char *diff)
+{
+    float *lab = malloc(sizeof(float) * 3 * (size_t)width * height);
+    diff_result result = { 0.0, 0.0 };
+    if (!lab)
+    {
+        result.bad_fraction = 1.0;
+        return result;
+    }
+    for (int i = 0; i < width * height; i++)
+        srgb_to_lab(&golden[i * 4], &lab[i * 3]);
+
+    double total = 0.0;
+    int bad = 0;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int i = y * width + x;
+            float a[3];
+            srgb_to_lab(&actual[i * 4], a);
+            float centre = delta_e(a, &lab[i * 3]);
+            float best = centre;
+            for (int ny = y - 1; ny <= y + 1 && best > max_delta_e; ny++)
+            {
+                for (int nx = x - 1; nx <= x + 1; nx++)
+                {
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                        continue;
+                    float d = delta_e(a, &lab[(ny * width + nx) * 3]);
+                    if (d < best)
+                        best = d;
+                }
+            }
+            total += centre;
+            if (best > max_delta_e)
+                bad++;
+            if (diff)
+            {
+                unsigned char grey = (unsigned char)(lab[i * 3] * 0.25f * 2.55f);
+                diff[i * 4 + 0] = best > max_delta_e ? 255 : grey;
+                diff[i * 4 + 1] = best > max_delta_e ? 0 : grey;
+                diff[i * 4 + 2] = best > max_delta_e ? 0 : grey;
+                diff[i * 4 + 3] = 255;
+            }
+        }
+    }
+    free(lab);
+    result.mean_delta_e = total / ((double)width * height);
+    result.bad_fraction = (double)bad / ((double)width * height);
+    return result;
+}
+
+/* RGBA8 pixels, top row first */
+static bool write_png(const char *file, const unsigned char *rgba, int width, int height)
+{
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    image.width = (png_uint_32)width;
+    image.height = (png_uint_32)height;
+    image.format = PNG_FORMAT_RGBA;
+    if (!png_image_write_to_file(&image, file, 0, rgba, 0, NULL))
+    {
+        fprintf(stderr, "Error: cannot write %s: %s\n", file, image.message);
+        return false;
+    }
+    return true;
+}
+
+/* A PNG as RGBA8 top row first, or NULL; the caller frees it */
+static unsigned char *read_png(const char *file, int *width, int *height)
+{
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, file))
+        return NULL;
+    image.format = PNG_FORMAT_RGBA;
+    unsigned char *rgba = malloc(PNG_IMAGE_SIZE(image));
+    if (!rgba || !png_image_finish_read(&image, NULL, rgba, 0, NULL))
+    {
+        fprintf(stderr, "Error: cannot read %s: %s\n", file, image.message);
+        png_image_free(&image);
+        free(rgba);
+        return NULL;
+    }
+    *width = (int)image.width;
+    *height = (int)image.height;
+    return rgba;
+}
+
+/* Render v with configuration c and read the last frame back, top row
+   first. Frames are drawn at time_s = 0 on a renderer of their own, so
+   nothing carries over from another view. */
+static bool render_view(const view *v, const config *c, int width, int height, unsigned char *rgba)
+{
+    gl_renderer *renderer = gl_renderer_create_headless(width, height);
+    if (!renderer || !gl_renderer_ok(renderer))
+    {
+        fprintf(stderr, "Error: Failed to create headless OpenGL renderer\n");
+        if (renderer)
+            gl_renderer_destroy(renderer);
+        return false;
+    }
+    gl_renderer_set_distance_cache(renderer, c->sdf_cache);
+    gl_renderer_set_march(renderer, c->march);
+    gl_renderer_set_reprojection(renderer, c->frames > 1);
+
+    for (int i = c->frames - 1; i >= 0; i--)
+    {
+        camera_t cam = { 0 };
+        memcpy(cam.pos, v->pos, sizeof(cam.pos));
+        cam.pos[0] += (float)i * REPROJECT_STEP;
+        camera_look_at(&cam, v->target);
+        gl_renderer_draw(renderer, 0.0f, &cam);
+    }
+    gl_renderer_finish(renderer);
+
+    unsigned char *bottom_up = malloc((size_t)width * height * 4);
+    if (!bottom_up || !gl_renderer_read_output(renderer, bottom_up))
+    {
+        fprintf(stderr, "Error: cannot read back view %s\n", v->name);
+        free(bottom_up);
+        gl_renderer_destroy(renderer);
+        return false;
+    }
+    for (int y = 0; y < height; y++)
+        memcpy(rgba + (size_t)y * width * 4, bottom_up + (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+    free(bottom_up);
+    gl_renderer_destroy(renderer);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *golden_dir = "golden";
+    const char *out_dir = "build/regress";
+    const char *only_view = NULL;
+    const char *only_config = NULL;
+    bool update = false;
+    double max_delta_e = DEFAULT_MAX_DELTA_E;
+    double max_bad = DEFAULT_MAX_BAD;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--update") == 0)
+            update = true;
+        else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+            golden_dir = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out_dir = argv[++i];
+        else if (strcmp(argv[i], "--view") == 0 && i + 1 < argc)
+            only_view = argv[++i];
+        else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+            only_config = argv[++i];
+        else if (strcmp(argv[i], "--max-delta-e") == 0 && i + 1 < argc)
+            max_delta_e = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-bad") == 0 && i + 1 < argc)
+            max_bad = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--update] [--golden DIR] [--out DIR] [--view NAME]"
+                            " [--config default|sdf-cache|plain|reproject] [--max-delta-e DE] [--max-bad FRACTION]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    unsigned char *actual = malloc((size_t)width * height * 4);
+    unsigned char *diff = malloc((size_t)width * height * 4);
+    if (!actual || !diff)
+    {
+        free(actual);
+        free(diff);
+        return 1;
+    }
+
+    int checked = 0, failed = 0;
+    /* The goldens come from the first configuration, the default */
+    for (int c = 0; c < (update ? 1 : CONFIG_COUNT); c++)
+    {
+        if (only_config && strcmp(only_config, configs[c].name) != 0)
+            continue;
+        for (int v = 0; v < VIEW_COUNT; v++)
+        {
+            if (only_view && strcmp(only_view, views[v].name) != 0)
+                continue;
+            checked++;
+
+            char golden_file[MAX_PATH], actual_file[MAX_PATH], diff_file[MAX_PATH];
+            snprintf(golden_file, sizeof(golden_file), "%s/%s.png", golden_dir, views[v].name);
+            snprintf(actual_file, sizeof(actual_file), "%s/%s-%s.png", out_dir, views[v].name, configs[c].name);
+            snprintf(diff_file, sizeof(diff_file), "%s/%s-%s-diff.png", out_dir, views[v].name, configs[c].name);
+
+            if (!render_view(&views[v], &configs[c], width, height, actual))
+            {
+                failed++;
+                continue;
+            }
+
+            if (update)
+            {
+                if (!write_png(golden_file, actual, width, height))
+                    failed++;
+                else
+                    printf("%-8s updated %s\n", views[v].name, golden_file);
+                continue;
+            }
+
+            int gw, gh;
+            unsigned char *golden = read_png(golden_file, &gw, &gh);
+            if (!golden || gw != width || gh != height)
+            {
+                printf("%-8s %-9s FAIL  %s\n", views[v].name, configs[c].name,
+                       golden ? "golden size differs" : "no golden image; run with --update to create it");
+                free(golden);
+                failed++;
+                continue;
+            }
+
+            diff_result result = compare_images(actual, golden, width, height, max_delta_e, diff);
+            free(golden);
+            bool pass = result.bad_fraction <= (configs[c].max_bad > 0.0 ? configs[c].max_bad : max_bad);
+            printf("%-8s %-9s %s  mean dE %.3f, %.3f%% of pixels beyond dE %.1f\n", views[v].name,
+                   configs[c].name, pass ? "ok  " : "FAIL", result.mean_delta_e, result.bad_fraction * 100.0,
+                   max_delta_e);
+            if (!pass)
+            {
+                /* Keep the frame and where it differs for inspection */
+                write_png(actual_file, actual, width, height);
+                write_png(diff_file, diff, width, height);
+                printf("                   see %s and %s\n", actual_file, diff_file);
+                failed++;
+            }
+        }
+    }
+
+    free(actual);
+    free(diff);
+
+    if (checked == 0)
+    {
+        fprintf(stderr, "Error: no view or configuration by that name\n");
+        return 1;
+    }
+    if (!update)
+        printf("%d of %d views match\n", checked - failed, checked);
+    return failed ? 1 : 0;
+}
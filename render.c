@@ -0,0 +1,266 @@
+/* Offline renderer: draws a still or a range of frames of the default
+   scene at any resolution to PNG. Each frame is split into tiles that are
+   raymarched by separate dispatches, so no single dispatch runs long
+   enough to trip a driver watchdog, and finished rows of tiles are handed
+   to the PNG encoder while the rest of the frame renders. Built by
+   `make forge-render`. */
+
+#include "gl_renderer.h"
+
+#include <math.h>
+#include <png.h>
+#include <SDL2/SDL.h>
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_WIDTH 7680
+#define DEFAULT_HEIGHT 4320
+#define DEFAULT_TILE 512
+#define DEFAULT_FPS 30.0f
+#define MAX_PATH 512
+
+static const char *const variant_names[GL_RENDERER_VARIANT_COUNT] = {
+    "medium", "low", "high", "no-shadows", "no-ao",
+};
+
+/* Render one width x height frame seen by cam into a PNG, tile x tile
+   pixels per dispatch and samples dispatches per tile. Tiles are drawn in
+   bands from the top of the image down, and each band's rows are encoded
+   as soon as it is complete, so only one band is ever held in memory. */
+static bool render_frame(gl_renderer *renderer, const camera_t *cam, float time_s, int width, int height, int tile,
+                         int samples, const char *file)
+{
+    FILE *f = fopen(file, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "Error: cannot write %s\n", file);
+        return false;
+    }
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    unsigned char *band = malloc((size_t)width * tile * 4);
+    unsigned char *pixels = malloc((size_t)tile * tile * 4);
+    if (!info || !band || !pixels)
+    {
+        fprintf(stderr, "Error: out of memory for %s\n", file);
+        png_destroy_write_struct(&png, &info);
+        free(band);
+        free(pixels);
+        fclose(f);
+        return false;
+    }
+    if (setjmp(png_jmpbuf(png)))
+    {
+        fprintf(stderr, "Error: cannot encode %s\n", file);
+        png_destroy_write_struct(&png, &info);
+        free(band);
+        free(pixels);
+        fclose(f);
+        return false;
+    }
+
+    png_init_io(png, f);
+    png_set_IHDR(png, info, (png_uint_32)width, (png_uint_32)height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    png_set_filler(png, 0, PNG_FILLER_AFTER);   /* drop the alpha byte of each pixel */
+
+    bool ok = true;
+    for (int top = height; top > 0 && ok; top -= tile)
+    {
+        int y = top > tile ? top - tile : 0;
+        int band_height = top - y;
+        for (int x = 0; x < width && ok; x += tile)
+        {
+            int tile_width = width - x < tile ? width - x : tile;
+            for (int i = 0; i < samples && ok; i++)
+                ok = gl_renderer_draw_tile(renderer, time_s, cam, width, height, x, y, tile_width, band_height);
+            ok = ok && gl_renderer_read_output(renderer, pixels);
+            for (int row = 0; ok && row < band_height; row++)
+                memcpy(band + ((size_t)row * width + x) * 4, pixels + (size_t)row * tile_width * 4,
+                       (size_t)tile_width * 4);
+        }
+        /* The tiles are bottom row first; PNG rows run top down */
+        for (int row = band_height - 1; ok && row >= 0; row--)
+            png_write_row(png, band + (size_t)row * width * 4);
+    }
+    if (ok)
+        png_write_end(png, NULL);
+
+    png_destroy_write_struct(&png, &info);
+    free(band);
+    free(pixels);
+    if (fclose(f) != 0)
+        ok = false;
+    if (!ok)
+    {
+        fprintf(stderr, "Error: failed to render %s\n", file);
+        remove(file);
+    }
+    return ok;
+}
+
+/* A sequence's --output pattern, split around its one %d, %Nd or %0Nd */
+typedef struct {
+    const char *prefix;
+    int prefix_length;
+    bool zero_pad;
+    int width;
+    const char *suffix;
+} frame_pattern;
+
+/* Split output into p; false if it has any other conversion, or more
+   than one. The pattern is never handed to printf itself. */
+static bool parse_frame_pattern(const char *output, frame_pattern *p)
+{
+    const char *c = strchr(output, '%');
+    if (!c)
+        return false;
+    p->prefix = output;
+    p->prefix_length = (int)(c - output);
+    c++;
+    p->zero_pad = *c == '0';
+    if (p->zero_pad)
+        c++;
+    p->width = 0;
+    while (isdigit((unsigned char)*c))
+    {
+        p->width = p->width * 10 + (*c++ - '0');
+        if (p->width > 32)
+            return false;
+    }
+    if (*c != 'd' || strchr(c + 1, '%'))
+        return false;
+    p->suffix = c + 1;
+    return true;
+}
+
+/* "X,Y,Z" into v */
+static bool parse_vec3(const char *arg, float v[3])
+{
+    return sscanf(arg, "%f,%f,%f", &v[0], &v[1], &v[2]) == 3;
+}
+
+int main(int argc, char **argv)
+{
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    int tile = DEFAULT_TILE;
+    int samples = 1;
+    int first = 0, last = 0;
+    bool sequence = false;
+    bool orbit = false;
+    float fps = DEFAULT_FPS;
+    float pos[3] = { 0.0f, 0.0f, 0.0f };
+    float target[3] = { 0.0f, 0.0f, -1.0f };
+    const char *output = NULL;
+    frame_pattern pattern = { 0 };
+    gl_renderer_variant variant = GL_RENDERER_VARIANT_HIGH;
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            usage = sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 1 || height < 1;
+        else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc)
+            usage = (tile = atoi(argv[++i])) < 8;
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+            usage = (samples = atoi(argv[++i])) < 1;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            usage = !(sequence = sscanf(argv[++i], "%d-%d", &first, &last) == 2) || first < 0 || last < first;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            usage = (fps = (float)atof(argv[++i])) <= 0.0f;
+        else if (strcmp(argv[i], "--camera") == 0 && i + 1 < argc)
+            usage = !parse_vec3(argv[++i], pos);
+        else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc)
+            usage = !parse_vec3(argv[++i], target);
+        else if (strcmp(argv[i], "--orbit") == 0)
+            orbit = true;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            usage = true;
+            for (int v = 0; v < GL_RENDERER_VARIANT_COUNT; v++)
+            {
+                if (strcmp(name, variant_names[v]) == 0)
+                {
+                    variant = (gl_renderer_variant)v;
+                    usage = false;
+                }
+            }
+        }
+        else
+            usage = true;
+    }
+    if (!output)
+        output = sequence ? "build/render_%04d.png" : "build/render.png";
+    if (sequence && !parse_frame_pattern(output, &pattern))
+    {
+        fprintf(stderr, "Error: --frames needs an --output pattern with one frame number, %%d, %%Nd or %%0Nd,"
+                        " and no other %%, e.g. out_%%04d.png\n");
+        usage = true;
+    }
+    if (usage)
+    {
+        fprintf(stderr, "Usage: %s [--size WxH] [--tile N] [--samples N] [--output FILE] [--frames FIRST-LAST]"
+                        " [--fps N] [--camera X,Y,Z] [--target X,Y,Z] [--orbit]"
+                        " [--variant medium|low|high|no-shadows|no-ao]\n", argv[0]);
+        return 1;
+    }
+
+    gl_renderer *renderer = gl_renderer_create_headless(width < tile ? width : tile, height < tile ? height : tile);
+    if (!renderer || !gl_renderer_ok(renderer))
+    {
+        fprintf(stderr, "Error: Failed to create headless OpenGL renderer\n");
+        if (renderer)
+            gl_renderer_destroy(renderer);
+        return 1;
+    }
+    gl_renderer_set_variant(renderer, variant);
+    /* Several samples per tile are jittered and averaged */
+    gl_renderer_set_accumulation(renderer, samples > 1);
+
+    /* --orbit circles the target once over the range, at the camera's
+       starting height and distance */
+    float dx = pos[0] - target[0], dz = pos[2] - target[2];
+    float radius = sqrtf(dx * dx + dz * dz);
+    float angle0 = atan2f(dx, dz);
+    int tiles = ((width + tile - 1) / tile) * ((height + tile - 1) / tile);
+
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    for (int frame = first; frame <= last; frame++)
+    {
+        camera_t cam = { 0 };
+        memcpy(cam.pos, pos, sizeof(cam.pos));
+        if (orbit)
+        {
+            float a = angle0 + 6.2831853f * (float)(frame - first) / (float)(last - first + 1);
+            cam.pos[0] = target[0] + radius * sinf(a);
+            cam.pos[2] = target[2] + radius * cosf(a);
+        }
+        camera_look_at(&cam, target);
+
+        char file[MAX_PATH];
+        if (sequence)
+            snprintf(file, sizeof(file), pattern.zero_pad ? "%.*s%0*d%s" : "%.*s%*d%s", pattern.prefix_length,
+                     pattern.prefix, pattern.width, frame, pattern.suffix);
+        else
+            snprintf(file, sizeof(file), "%s", output);
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        if (!render_frame(renderer, &cam, (float)frame / fps, width, height, tile, samples, file))
+        {
+            gl_renderer_destroy(renderer);
+            return 1;
+        }
+        printf("%s: %dx%d in %d tiles x %d samples, %.2f s\n", file, width, height, tiles, samples,
+               (double)(SDL_GetPerformanceCounter() - t0) / (double)freq);
+    }
+
+    gl_renderer_destroy(renderer);
+    return 0;
+}
@@ -0,0 +1,672 @@
+#include "scene.h"
+
+#include <math.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t first_node;
+    uint32_t node_count;
+    float lo[3];        /* model-space bounds */
+    float hi[3];
+} scene_model;
+
+/* Placement as given by the caller; the GPU record holds its inverse */
+typedef struct {
+    float pos[3];
+    float yaw;
+    float scale;
+    int model;
+} scene_placement;
+
+/* World bounds of one object, used while building the BVH */
+typedef struct {
+    float lo[3];
+    float hi[3];
+    float centre[3];
+} scene_bounds;
+
+struct scene {
+    gpu_scene_node *nodes;
+    int node_count;
+    int node_capacity;
+
+    scene_model *models;
+    int model_count;
+    int model_capacity;
+
+    gpu_scene_object *objects;
+    scene_placement *placements;
+    int object_count;
+    int object_capacity;
+    int placement_capacity;
+
+    float *materials;
+    int material_count;
+    int material_capacity;
+
+    /* Model being recorded */
+    bool recording;
+    bool record_error;
+    int record_first;
+    bool group_open;
+    bool group_pending;
+    uint32_t group_op;
+    float group_k;
+
+    gpu_bvh_node *bvh;
+    int bvh_count;
+    int bvh_capacity;
+    scene_bounds *bounds;
+    int *bvh_order;
+    int bounds_capacity;
+    int order_capacity;
+    bool bvh_dirty;
+
+    uint32_t structure_version;
+    uint32_t static_version;
+    int dynamic_count;
+    int dirty_begin;
+    int dirty_end;
+};
+
+/* Grow *items to hold at least count elements of size bytes each. */
+static bool reserve(void **items, int *capacity, int count, size_t size)
+{
+    if (count <= *capacity)
+        return true;
+    int cap = *capacity ? *capacity * 2 : 16;
+    while (cap < count)
+        cap *= 2;
+    void *p = realloc(*items, (size_t)cap * size);
+    if (!p)
+        return false;
+    *items = p;
+    *capacity = cap;
+    return true;
+}
+
+scene *scene_create(void)
+{
+    return calloc(1, sizeof(scene));
+}
+
+void scene_destroy(scene *s)
+{
+    if (!s)
+        return;
+    free(s->nodes);
+    free(s->models);
+    free(s->objects);
+    free(s->placements);
+    free(s->materials);
+    free(s->bvh);
+    free(s->bounds);
+    free(s->bvh_order);
+    free(s);
+}
+
+void scene_clear(scene *s)
+{
+    s->node_count = 0;
+    s->model_count = 0;
+    s->object_count = 0;
+    s->dynamic_count = 0;
+    s->material_count = 0;
+    s->recording = false;
+    s->bvh_dirty = true;
+    s->structure_version++;
+    s->dirty_begin = s->dirty_end = 0;
+}
+
+int scene_add_material(scene *s, float r, float g, float b)
+{
+    if (!reserve((void **)&s->materials, &s->material_capacity, (s->material_count + 1) * 4, sizeof(float)))
+        return -1;
+    float *m = s->materials + s->material_count * 4;
+    m[0] = r;
+    m[1] = g;
+    m[2] = b;
+    m[3] = 1.0f;
+    s->structure_version++;
+    return s->material_count++;
+}
+
+void scene_begin_model(scene *s)
+{
+    s->recording = true;
+    s->record_error = false;
+    s->record_first = s->node_count;
+    s->group_open = false;
+    s->group_pending = false;
+}
+
+void scene_prim(scene *s, scene_prim_type type, const float offset[3], float yaw,
+                const float params[4], int material, scene_op op, float k)
+{
+    if (!s->recording || !reserve((void **)&s->nodes, &s->node_capacity, s->node_count + 1, sizeof(gpu_scene_node))) {
+        s->record_error = true;
+        return;
+    }
+    if (type > SCENE_PRIM_TORUS || material < 0 || material >= s->material_count)
+        s->record_error = true;
+
+    gpu_scene_node *n = &s->nodes[s->node_count];
+    memset(n, 0, sizeof(*n));
+    memcpy(n->offset, offset, sizeof(n->offset));
+    memcpy(n->params, params, sizeof(n->params));
+    /* Sample points are rotated by -yaw into the primitive's frame */
+    n->rot[0] = cosf(-yaw);
+    n->rot[1] = sinf(-yaw);
+    n->material = (uint32_t)material;
+
+    if (s->group_pending) {
+        /* The first node of a group carries the group's join instead */
+        op = (scene_op)s->group_op;
+        k = s->group_k;
+        n->type_op |= SCENE_NODE_GROUP_BEGIN;
+        s->group_pending = false;
+    }
+    /* The first node of a model (or group) has nothing to blend with */
+    if (s->node_count == s->record_first)
+        op = SCENE_OP_UNION;
+
+    n->type_op |= (uint32_t)type | ((uint32_t)op << 8);
+    n->k = k;
+    s->node_count++;
+}
+
+void scene_begin_group(scene *s, scene_op op, float k)
+{
+    if (s->group_open)
+        s->record_error = true;
+    s->group_open = true;
+    s->group_pending = true;
+    s->group_op = (uint32_t)op;
+    s->group_k = k;
+}
+
+void scene_end_group(scene *s)
+{
+    if (!s->group_open || s->group_pending)
+        s->record_error = true;
+    else
+        s->nodes[s->node_count - 1].type_op |= SCENE_NODE_GROUP_END;
+    s->group_open = false;
+    s->group_pending = false;
+}
+
+static void bounds_merge(float lo[3], float hi[3], const float plo[3], const float phi[3], float grow)
+{
+    for (int i = 0; i < 3; i++) {
+        lo[i] = fminf(lo[i], plo[i] - grow);
+        hi[i] = fmaxf(hi[i], phi[i] + grow);
+    }
+}
+
+/* Model-space box around one node's primitive */
+static void node_bounds(const gpu_scene_node *n, float lo[3], float hi[3])
+{
+    const float *p = n->params;
+    float e[3];
+    switch (n->type_op & 0xffu) {
+    case SCENE_PRIM_SPHERE:
+        e[0] = e[1] = e[2] = p[0];
+        break;
+    case SCENE_PRIM_BOX: {
+        /* Rotated about Y: the xz footprint of the turned box */
+        float c = fabsf(n->rot[0]), sn = fabsf(n->rot[1]);
+        e[0] = c * p[0] + sn * p[2];
+        e[1] = p[1];
+        e[2] = sn * p[0] + c * p[2];
+        break;
+    }
+    case SCENE_PRIM_CAPPED_CONE:
+        e[0] = e[2] = fmaxf(p[1], p[2]);
+        e[1] = p[0];
+        break;
+    default: /* torus */
+        e[0] = e[2] = p[0] + p[1];
+        e[1] = p[1];
+        break;
+    }
+    for (int i = 0; i < 3; i++) {
+        lo[i] = n->offset[i] - e[i];
+        hi[i] = n->offset[i] + e[i];
+    }
+}
+
+/* Fold a node's (or group's) bounds into a running box. Only unions can
+   add volume. A smooth union lies at most k inside min(a, b), so it can
+   bulge up to k beyond either operand and the merged box grows by k.
+   Subtractions and intersections never grow the shape. */
+static void bounds_apply(uint32_t op, float k, float lo[3], float hi[3], const float plo[3], const float phi[3])
+{
+    if (op == SCENE_OP_UNION || op == SCENE_OP_SMOOTH_UNION)
+        bounds_merge(lo, hi, plo, phi, 0.0f);
+    if (op == SCENE_OP_SMOOTH_UNION)
+        for (int i = 0; i < 3; i++) {
+            lo[i] -= k;
+            hi[i] += k;
+        }
+}
+
+static void model_bounds(const scene *s, scene_model *m)
+{
+    float group_lo[3], group_hi[3];
+    uint32_t join_op = SCENE_OP_UNION;
+    float join_k = 0.0f;
+    bool in_group = false;
+
+    for (int i = 0; i < 3; i++) {
+        m->lo[i] = 1e30f;
+        m->hi[i] = -1e30f;
+    }
+    for (uint32_t i = 0; i < m->node_count; i++) {
+        const gpu_scene_node *n = &s->nodes[m->first_node + i];
+        uint32_t op = (n->type_op >> 8) & 0xffu;
+        float lo[3], hi[3];
+        node_bounds(n, lo, hi);
+
+        if (n->type_op & SCENE_NODE_GROUP_BEGIN) {
+            memcpy(group_lo, lo, sizeof(lo));
+            memcpy(group_hi, hi, sizeof(hi));
+            join_op = op;
+            join_k = n->k;
+            in_group = true;
+        } else if (in_group) {
+            bounds_apply(op, n->k, group_lo, group_hi, lo, hi);
+        } else {
+            bounds_apply(op, n->k, m->lo, m->hi, lo, hi);
+        }
+        if (n->type_op & SCENE_NODE_GROUP_END) {
+            bounds_apply(join_op, join_k, m->lo, m->hi, group_lo, group_hi);
+            in_group = false;
+        }
+    }
+}
+
+int scene_end_model(scene *s)
+{
+    bool ok = s->recording && !s->record_error && !s->group_open && s->node_count > s->record_first;
+    s->recording = false;
+    if (ok && reserve((void **)&s->models, &s->model_capacity, s->model_count + 1, sizeof(scene_model))) {
+        scene_model *m = &s->models[s->model_count];
+        m->first_node = (uint32_t)s->record_first;
+        m->node_count = (uint32_t)(s->node_count - s->record_first);
+        model_bounds(s, m);
+        s->structure_version++;
+        return s->model_count++;
+    }
+
+    fprintf(stderr, "scene: invalid model discarded\n");
+    s->node_count = s->record_first;
+    return -1;
+}
+
+static void prim(scene *s, scene_prim_type type, float y, float p0, float p1, float p2, int material,
+                 scene_op op, float k)
+{
+    const float offset[3] = { 0.0f, y, 0.0f };
+    const float params[4] = { p0, p1, p2, 0.0f };
+    scene_prim(s, type, offset, 0.0f, params, material, op, k);
+}
+
+int scene_add_pawn_model(scene *s, int material)
+{
+    scene_begin_model(s);
+    prim(s, SCENE_PRIM_CAPPED_CONE, 0.0f, 0.1f, 0.5f, 0.5f, material, SCENE_OP_UNION, 0.0f);                /* base */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 0.2f, 0.15f, 0.32f, 0.32f, material, SCENE_OP_SMOOTH_UNION, 0.01f);     /* base2 */
+    prim(s, SCENE_PRIM_TORUS, 0.05f, 0.48f, 0.05f, 0.0f, material, SCENE_OP_SMOOTH_SUBTRACTION, 0.02f);    /* ring */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 0.6f, 0.4f, 0.4f, 0.2f, material, SCENE_OP_SMOOTH_UNION, 0.1f);        /* neck */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 1.0f, 0.03f, 0.3f, 0.3f, material, SCENE_OP_SMOOTH_UNION, 0.05f);      /* neck2 */
+    prim(s, SCENE_PRIM_SPHERE, 1.3f, 0.3f, 0.0f, 0.0f, material, SCENE_OP_SMOOTH_UNION, 0.02f);            /* head */
+    return scene_end_model(s);
+}
+
+int scene_add_rook_model(scene *s, int material)
+{
+    const float PI = 3.14159265f;
+
+    scene_begin_model(s);
+    prim(s, SCENE_PRIM_CAPPED_CONE, 0.0f, 0.1f, 0.5f, 0.5f, material, SCENE_OP_UNION, 0.0f);                /* base */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 0.2f, 0.15f, 0.32f, 0.32f, material, SCENE_OP_SMOOTH_UNION, 0.01f);     /* base2 */
+    prim(s, SCENE_PRIM_TORUS, 0.05f, 0.48f, 0.05f, 0.0f, material, SCENE_OP_SMOOTH_SUBTRACTION, 0.02f);    /* ring */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 0.6f, 0.4f, 0.4f, 0.2f, material, SCENE_OP_SMOOTH_UNION, 0.1f);        /* neck */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 1.0f, 0.03f, 0.3f, 0.3f, material, SCENE_OP_SMOOTH_UNION, 0.05f);      /* neck2 */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 1.15f, 0.15f, 0.2f, 0.28f, material, SCENE_OP_SMOOTH_UNION, 0.02f);    /* neck3 */
+    prim(s, SCENE_PRIM_CAPPED_CONE, 1.3f, 0.05f, 0.28f, 0.28f, material, SCENE_OP_SMOOTH_UNION, 0.02f);    /* head */
+
+    /* Crown with six crenellation gaps cut out before it joins the body */
+    scene_begin_group(s, SCENE_OP_SMOOTH_UNION, 0.02f);
+    prim(s, SCENE_PRIM_TORUS, 1.4f, 0.255f, 0.05f, 0.0f, material, SCENE_OP_UNION, 0.0f);
+    for (int i = 0; i < 6; i++) {
+        const float offset[3] = { 0.0f, 1.4f, 0.0f };
+        const float params[4] = { 0.34f, 0.12f, 0.05f, 0.0f };
+        scene_prim(s, SCENE_PRIM_BOX, offset, (float)i * PI / 3.0f, params, material,
+                   SCENE_OP_SMOOTH_SUBTRACTION, 0.008f);
+    }
+    scene_end_group(s);
+    return scene_end_model(s);
+}
+
+static void write_transform(gpu_scene_object *o, const float pos[3], float yaw, float scale)
+{
+    /* model = rotate_y(world - pos, -yaw) / scale */
+    float c = cosf(yaw), sn = sinf(yaw);
+    float inv = 1.0f / scale;
+    const float rows[3][3] = {
+        { c, 0.0f, -sn },
+        { 0.0f, 1.0f, 0.0f },
+        { sn, 0.0f, c },
+    };
+    for (int i = 0; i < 3; i++) {
+        o->xform[i][0] = rows[i][0] * inv;
+        o->xform[i][1] = rows[i][1] * inv;
+        o->xform[i][2] = rows[i][2] * inv;
+        o->xform[i][3] = -(rows[i][0] * pos[0] + rows[i][1] * pos[1] + rows[i][2] * pos[2]) * inv;
+    }
+    o->scale = scale;
+}
+
+int scene_add_object(scene *s, int model, const float pos[3], float yaw, float scale)
+{
+    if (model < 0 || model >= s->model_count || scale <= 0.0f)
+        return -1;
+    if (!reserve((void **)&s->objects, &s->object_capacity, s->object_count + 1, sizeof(gpu_scene_object)) ||
+        !reserve((void **)&s->placements, &s->placement_capacity, s->object_count + 1, sizeof(scene_placement)))
+        return -1;
+
+    gpu_scene_object *o = &s->objects[s->object_count];
+    memset(o, 0, sizeof(*o));
+    o->first_node = s->models[model].first_node;
+    o->node_count = s->models[model].node_count;
+    write_transform(o, pos, yaw, scale);
+    s->placements[s->object_count] = (scene_placement){ { pos[0], pos[1], pos[2] }, yaw, scale, model };
+    s->bvh_dirty = true;
+    s->structure_version++;
+    return s->object_count++;
+}
+
+void scene_set_object_transform(scene *s, int object, const float pos[3], float yaw, float scale)
+{
+    if (object < 0 || object >= s->object_count || scale <= 0.0f)
+        return;
+    write_transform(&s->objects[object], pos, yaw, scale);
+    if (!(s->objects[object].flags & SCENE_OBJECT_DYNAMIC)) {
+        s->objects[object].flags |= SCENE_OBJECT_DYNAMIC;
+        s->dynamic_count++;
+        s->static_version++;
+    }
+    s->placements[object].pos[0] = pos[0];
+    s->placements[object].pos[1] = pos[1];
+    s->placements[object].pos[2] = pos[2];
+    s->placements[object].yaw = yaw;
+    s->placements[object].scale = scale;
+    s->bvh_dirty = true;
+
+    if (s->dirty_begin == s->dirty_end) {
+        s->dirty_begin = object;
+        s->dirty_end = object + 1;
+    } else {
+        if (object < s->dirty_begin)
+            s->dirty_begin = object;
+        if (object + 1 > s->dirty_end)
+            s->dirty_end = object + 1;
+    }
+}
+
+bool scene_get_object_transform(const scene *s, int object, float pos[3], float *yaw, float *scale)
+{
+    if (object < 0 || object >= s->object_count)
+        return false;
+    const scene_placement *p = &s->placements[object];
+    memcpy(pos, p->pos, sizeof(p->pos));
+    *yaw = p->yaw;
+    *scale = p->scale;
+    return true;
+}
+
+int scene_object_count(const scene *s)
+{
+    return s->object_count;
+}
+
+int scene_dynamic_object_count(const scene *s)
+{
+    return s->dynamic_count;
+}
+
+int scene_node_count(const scene *s)
+{
+    return s->node_count;
+}
+
+bool scene_build_default(scene *s)
+{
+    scene_clear(s);
+
+    int board = scene_add_material(s, 0.35f, 0.35f, 0.4f);
+    int white = scene_add_material(s, 1.0f, 1.0f, 1.0f);
+
+    scene_begin_model(s);
+    const float origin[3] = { 0.0f, 0.0f, 0.0f };
+    const float plane[4] = { 100.0f, 0.5f, 100.0f, 0.0f };
+    scene_prim(s, SCENE_PRIM_BOX, origin, 0.0f, plane, board, SCENE_OP_UNION, 0.0f);
+    int plane_model = scene_end_model(s);
+    int pawn = scene_add_pawn_model(s, white);
+    int rook = scene_add_rook_model(s, white);
+    if (plane_model < 0 || pawn < 0 || rook < 0)
+        return false;
+
+    const float plane_pos[3] = { 0.0f, -1.5f, 0.0f };
+    const float pawn_pos[2][3] = { { -1.0f, -1.0f, -5.0f }, { 1.0f, -1.0f, -5.0f } };
+    const float rook_pos[3] = { 0.0f, -1.0f, -3.0f };
+    return scene_add_object(s, plane_model, plane_pos, 0.0f, 1.0f) >= 0 &&
+           scene_add_object(s, pawn, pawn_pos[0], 0.0f, 1.0f) >= 0 &&
+           scene_add_object(s, pawn, pawn_pos[1], 0.0f, 1.0f) >= 0 &&
+           scene_add_object(s, rook, rook_pos, 0.0f, 1.0f) >= 0;
+}
+
+bool scene_build_board(scene *s, int pieces)
+{
+    scene_clear(s);
+
+    int board = scene_add_material(s, 0.35f, 0.35f, 0.4f);
+    int white = scene_add_material(s, 1.0f, 1.0f, 1.0f);
+    int black = scene_add_material(s, 0.15f, 0.15f, 0.17f);
+
+    scene_begin_model(s);
+    const float origin[3] = { 0.0f, 0.0f, 0.0f };
+    const float plane[4] = { 100.0f, 0.5f, 100.0f, 0.0f };
+    scene_prim(s, SCENE_PRIM_BOX, origin, 0.0f, plane, board, SCENE_OP_UNION, 0.0f);
+    int plane_model = scene_end_model(s);
+    int models[2][2] = {
+        { scene_add_pawn_model(s, white), scene_add_rook_model(s, white) },
+        { scene_add_pawn_model(s, black), scene_add_rook_model(s, black) },
+    };
+    if (plane_model < 0 || models[0][0] < 0 || models[0][1] < 0 || models[1][0] < 0 || models[1][1] < 0)
+        return false;
+
+    const float plane_pos[3] = { 0.0f, -1.5f, 0.0f };
+    if (scene_add_object(s, plane_model, plane_pos, 0.0f, 1.0f) < 0)
+        return false;
+
+    /* Chess layout first (back ranks hold rooks), then the middle ranks,
+       then further ranks behind the board for larger counts */
+    const int rank_order[8] = { 0, 1, 7, 6, 2, 3, 4, 5 };
+    const float spacing = 1.25f;
+    for (int i = 0; i < pieces; i++) {
+        int file = i % 8;
+        int rank = i / 8 < 8 ? rank_order[i / 8] : i / 8;
+        int side = rank >= 4 ? 1 : 0;
+        int kind = (rank == 0 || rank == 7) ? 1 : 0;
+        const float pos[3] = { ((float)file - 3.5f) * spacing, -1.0f, -3.0f - (float)rank * spacing };
+        if (scene_add_object(s, models[side][kind], pos, 0.0f, 1.0f) < 0)
+            return false;
+    }
+    return true;
+}
+
+const gpu_scene_node *scene_nodes(const scene *s)
+{
+    return s->nodes;
+}
+
+const gpu_scene_object *scene_objects(const scene *s)
+{
+    return s->objects;
+}
+
+const float *scene_materials(const scene *s)
+{
+    return s->materials;
+}
+
+int scene_material_count(const scene *s)
+{
+    return s->material_count;
+}
+
+/* World box of an object: its model box scaled, turned about Y and moved */
+static void object_bounds(const scene *s, int object, scene_bounds *b)
+{
+    const scene_placement *pl = &s->placements[object];
+    const scene_model *m = &s->models[pl->model];
+    float c = cosf(pl->yaw), sn = sinf(pl->yaw);
+    float mc[3], me[3];
+    for (int i = 0; i < 3; i++) {
+        mc[i] = 0.5f * (m->lo[i] + m->hi[i]) * pl->scale;
+        me[i] = 0.5f * (m->hi[i] - m->lo[i]) * pl->scale;
+    }
+    /* world = pos + rotate_y(model * scale, yaw) */
+    float wc[3] = { c * mc[0] + sn * mc[2], mc[1], -sn * mc[0] + c * mc[2] };
+    float we[3] = { fabsf(c) * me[0] + fabsf(sn) * me[2], me[1], fabsf(sn) * me[0] + fabsf(c) * me[2] };
+    for (int i = 0; i < 3; i++) {
+        b->centre[i] = pl->pos[i] + wc[i];
+        b->lo[i] = b->centre[i] - we[i];
+        b->hi[i] = b->centre[i] + we[i];
+    }
+}
+
+/* Reorder order[] so the object with the k-th smallest centre along axis
+   sits at k, with smaller ones before it and larger ones after. */
+static void select_median(const scene_bounds *bounds, int *order, int count, int k, int axis)
+{
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+        float pivot = bounds[order[(lo + hi) / 2]].centre[axis];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (bounds[order[i]].centre[axis] < pivot)
+                i++;
+            while (bounds[order[j]].centre[axis] > pivot)
+                j--;
+            if (i <= j) {
+                int t = order[i];
+                order[i++] = order[j];
+                order[j--] = t;
+            }
+        }
+        if (k <= j)
+            hi = j;
+        else if (k >= i)
+            lo = i;
+        else
+            break;
+    }
+}
+
+/* Top-down build: split at the median centre along the widest axis of the
+   centres. The caller reserves 2 * count - 1 nodes. Returns the index of the subtree's root;
+   *depth is raised to the number of interior levels on its deepest path. */
+static int build_bvh_node(scene *s, int *order, int count, int level, int *depth)
+{
+    if (level > *depth)
+        *depth = level;
+    int index = s->bvh_count++;
+    gpu_bvh_node *n = &s->bvh[index];
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    float clo[3] = { 1e30f, 1e30f, 1e30f }, chi[3] = { -1e30f, -1e30f, -1e30f };
+    for (int j = 0; j < count; j++) {
+        const scene_bounds *b = &s->bounds[order[j]];
+        bounds_merge(lo, hi, b->lo, b->hi, 0.0f);
+        bounds_merge(clo, chi, b->centre, b->centre, 0.0f);
+    }
+    for (int i = 0; i < 3; i++) {
+        n->centre[i] = 0.5f * (lo[i] + hi[i]);
+        n->extent[i] = 0.5f * (hi[i] - lo[i]);
+    }
+
+    if (count == 1) {
+        n->object = order[0];
+        n->right = 0;
+        return index;
+    }
+
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+        if (chi[i] - clo[i] > chi[axis] - clo[axis])
+            axis = i;
+    int half = count / 2;
+    select_median(s->bounds, order, count, half, axis);
+
+    n->object = -1;
+    build_bvh_node(s, order, half, level + 1, depth);
+    int right = build_bvh_node(s, order + half, count - half, level + 1, depth);
+    s->bvh[index].right = (uint32_t)right;
+    return index;
+}
+
+const gpu_bvh_node *scene_bvh(scene *s, int *node_count)
+{
+    if (s->bvh_dirty) {
+        int count = s->object_count;
+        s->bvh_count = 0;
+        if (count > 0) {
+            if (!reserve((void **)&s->bvh, &s->bvh_capacity, 2 * count - 1, sizeof(gpu_bvh_node)) ||
+                !reserve((void **)&s->bounds, &s->bounds_capacity, count, sizeof(scene_bounds)) ||
+                !reserve((void **)&s->bvh_order, &s->order_capacity, count, sizeof(int))) {
+                *node_count = 0;
+                return NULL;
+            }
+            for (int i = 0; i < count; i++) {
+                object_bounds(s, i, &s->bounds[i]);
+                s->bvh_order[i] = i;
+            }
+            int depth = 0;
+            build_bvh_node(s, s->bvh_order, count, 0, &depth);
+            if (depth > SCENE_BVH_MAX_DEPTH) {
+                s->bvh_count = 0;
+                *node_count = 0;
+                return NULL;
+            }
+        }
+        s->bvh_dirty = false;
+    }
+    *node_count = s->bvh_count;
+    return s->bvh;
+}
+
+uint32_t scene_structure_version(const scene *s)
+{
+    return s->structure_version;
+}
+
+uint32_t scene_static_version(const scene *s)
+{
+    return s->structure_version + s->static_version;
+}
+
+void scene_dirty_objects(const scene *s, int *dirty_begin, int *dirty_end)
+{
+    *dirty_begin = s->dirty_begin;
+    *dirty_end = s->dirty_end;
+}
+
+void scene_clear_dirty(scene *s)
+{
+    s->dirty_begin = s->dirty_end = 0;
+}
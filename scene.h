@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* C-side scene description for the raymarcher.
+
+   A scene is a list of objects. Each object places an instance of a model
+   with a rigid transform and uniform scale; the scene is the hard union of
+   all objects. A model is a sequence of primitive nodes, each folded into
+   the model's running distance with its own blend operator. A run of nodes
+   can be grouped so it is combined on its own first and then joined as a
+   unit (the rook's crown is cut by its crenellations before it is blended
+   onto the body). Models are shared, so a board of identical pieces costs
+   one node list plus one object each.
+
+   gl_renderer_set_scene uploads nodes, objects and materials into GPU
+   buffers that shaders/scene.glsl interprets. The enum values, flags and
+   gpu_* struct layouts below must match scene.glsl. */
+
+typedef enum {
+    SCENE_PRIM_SPHERE = 0,       /* params: radius */
+    SCENE_PRIM_BOX = 1,          /* params: half extents x, y, z */
+    SCENE_PRIM_CAPPED_CONE = 2,  /* params: half height, bottom radius, top radius */
+    SCENE_PRIM_TORUS = 3,        /* params: major radius, minor radius */
+} scene_prim_type;
+
+/* How a node (or a closed group) combines with what came before it. */
+typedef enum {
+    SCENE_OP_UNION = 0,
+    SCENE_OP_SUBTRACTION = 1,          /* removes the node from the running shape */
+    SCENE_OP_INTERSECTION = 2,
+    SCENE_OP_SMOOTH_UNION = 3,
+    SCENE_OP_SMOOTH_SUBTRACTION = 4,
+} scene_op;
+
+/* Node capacity of the GPU node table (a 48 KB uniform block). Nodes are
+   per model, not per object, so this bounds model complexity only. Drivers
+   with a smaller GL_MAX_UNIFORM_BLOCK_SIZE (GL only guarantees 16 KB, 341
+   nodes) get a table sized to their limit; see gl_renderer_set_scene. */
+#define SCENE_MAX_NODES 1024
+
+/* gpu_scene_node.type_op: primitive in bits 0-7, operator in bits 8-15 */
+#define SCENE_NODE_GROUP_BEGIN (1u << 16)  /* node starts a group; op/k are the group's join */
+#define SCENE_NODE_GROUP_END (1u << 17)    /* group is joined after this node */
+
+/* std430 layout of one node (48 bytes). */
+typedef struct {
+    float offset[3];     /* primitive centre in model space */
+    float k;             /* smoothing radius for smooth operators */
+    float params[4];     /* primitive dimensions */
+    float rot[2];        /* cos, sin of the inverse rotation about Y */
+    uint32_t type_op;    /* primitive, operator and group flags */
+    uint32_t material;   /* index into the material table */
+} gpu_scene_node;
+
+/* std430 layout of one object (64 bytes). */
+typedef struct {
+    float xform[3][4];   /* world-to-model affine rows, scale folded in */
+    uint32_t first_node;
+    uint32_t node_count;
+    float scale;         /* model-space distances are multiplied by this */
+    uint32_t flags;      /* SCENE_OBJECT_* */
+} gpu_scene_object;
+
+/* gpu_scene_object.flags: the object has moved since it was added, so
+   baked caches of static geometry leave it out */
+#define SCENE_OBJECT_DYNAMIC 1u
+
+/* std430 layout of one BVH node (32 bytes), an axis-aligned box. Leaves
+   hold one object; interior nodes have object -1, their left child at the
+   next index and their right child at index right. */
+typedef struct {
+    float centre[3];
+    uint32_t right;
+    float extent[3];     /* half size */
+    int32_t object;
+} gpu_bvh_node;
+
+/* Deepest BVH the shaders can traverse: scene.glsl keeps one deferred
+   subtree per interior level on a stack of this size. Median splits halve
+   the objects at every level, so any object count fits. */
+#define SCENE_BVH_MAX_DEPTH 32
+
+typedef struct scene scene;
+
+scene *scene_create(void);
+void scene_destroy(scene *s);
+
+/* Remove all models, objects and materials. */
+void scene_clear(scene *s);
+
+/* Add a material (linear RGB). Returns its index, or -1 on failure. */
+int scene_add_material(scene *s, float r, float g, float b);
+
+/* Models are recorded between scene_begin_model and scene_end_model.
+   The first node's operator is ignored. Groups may not nest or be empty.
+   scene_end_model returns the model id, or -1 if the recording was invalid. */
+void scene_begin_model(scene *s);
+void scene_prim(scene *s, scene_prim_type type, const float offset[3], float yaw,
+                const float params[4], int material, scene_op op, float k);
+void scene_begin_group(scene *s, scene_op op, float k);
+void scene_end_group(scene *s);
+int scene_end_model(scene *s);
+
+/* Built-in chess piece models, in the given material. */
+int scene_add_pawn_model(scene *s, int material);
+int scene_add_rook_model(scene *s, int material);
+
+/* Place a model. yaw rotates about Y (radians). Returns the object id, or
+   -1 for an invalid model or when out of memory. */
+int scene_add_object(scene *s, int model, const float pos[3], float yaw, float scale);
+
+/* Move an existing object. Only changed objects are re-uploaded. The first
+   move marks the object dynamic (SCENE_OBJECT_DYNAMIC). */
+void scene_set_object_transform(scene *s, int object, const float pos[3], float yaw, float scale);
+/* Read back an object's placement as last set. Returns false if there is
+   no such object. */
+bool scene_get_object_transform(const scene *s, int object, float pos[3], float *yaw, float *scale);
+
+int scene_object_count(const scene *s);
+int scene_dynamic_object_count(const scene *s);
+int scene_node_count(const scene *s);
+
+/* The default chess scene: board, two pawns and a rook. */
+bool scene_build_default(scene *s);
+
+/* A board with the given number of pieces laid out in chess ranks, white
+   and black, rooks on the back ranks. Object 0 is the board itself. */
+bool scene_build_board(scene *s, int pieces);
+
+/* Accessors used by the renderer when uploading. */
+const gpu_scene_node *scene_nodes(const scene *s);
+const gpu_scene_object *scene_objects(const scene *s);
+const float *scene_materials(const scene *s);   /* vec4 per material */
+int scene_material_count(const scene *s);
+
+/* Bounding volume hierarchy over the objects' world bounds, root at index 0.
+   Rebuilt on demand after objects are added or moved. Bounds are
+   conservative: every object lies inside its box, so the signed distance
+   to a box never exceeds the distance to what it contains. Returns NULL
+   (and a count of 0) if the build runs out of memory or the tree would be
+   deeper than SCENE_BVH_MAX_DEPTH; an empty scene returns no nodes. */
+const gpu_bvh_node *scene_bvh(scene *s, int *node_count);
+
+/* Upload bookkeeping: structure_version changes whenever nodes, materials or
+   the object count change; [dirty_begin, dirty_end) are objects whose
+   transforms changed since the last scene_clear_dirty. */
+uint32_t scene_structure_version(const scene *s);
+/* Changes whenever the static geometry does: any structural change, or an
+   object turning dynamic. */
+uint32_t scene_static_version(const scene *s);
+void scene_dirty_objects(const scene *s, int *dirty_begin, int *dirty_end);
+void scene_clear_dirty(scene *s);
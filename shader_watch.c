@@ -0,0 +1,106 @@
+#include "shader_watch.h"
+
+#include <SDL2/SDL.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+/* A save is reported once no event has arrived for this long */
+#define DEBOUNCE_MS 150
+#define MAX_CHANGED 16
+#define MAX_PATH_LEN 256
+
+struct shader_watch {
+    int fd;
+    int wd;
+    char dir[MAX_PATH_LEN];
+
+    /* Files changed since the last report, deduplicated */
+    char changed[MAX_CHANGED][MAX_PATH_LEN];
+    int changed_count;
+    Uint32 last_event_ms;
+
+    /* What the last report handed out */
+    const char *reported[MAX_CHANGED];
+};
+
+shader_watch *shader_watch_create(const char *dir)
+{
+    shader_watch *w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    snprintf(w->dir, sizeof(w->dir), "%s", dir);
+
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        free(w);
+        return NULL;
+    }
+    /* Watch the directory, not the files: saving by rename replaces the
+       file, which would end a watch on it */
+    w->wd = inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (w->wd < 0) {
+        fprintf(stderr, "shader_watch: cannot watch %s: %s\n", dir, strerror(errno));
+        close(w->fd);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+void shader_watch_destroy(shader_watch *w)
+{
+    if (!w)
+        return;
+    close(w->fd);
+    free(w);
+}
+
+static void add_changed(shader_watch *w, const char *name)
+{
+    char path[MAX_PATH_LEN];
+    int n = snprintf(path, sizeof(path), "%s/%s", w->dir, name);
+    if (n < 0 || (size_t)n >= sizeof(path))
+        return;
+    for (int i = 0; i < w->changed_count; i++) {
+        if (strcmp(w->changed[i], path) == 0)
+            return;
+    }
+    if (w->changed_count < MAX_CHANGED)
+        memcpy(w->changed[w->changed_count++], path, (size_t)n + 1);
+}
+
+int shader_watch_poll(shader_watch *w, const char *const **paths)
+{
+    if (!w)
+        return 0;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(w->fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len;) {
+            const struct inotify_event *e = (const struct inotify_event *)p;
+            /* Skip editor temporaries and backups (".x.swp", "x~") */
+            if (e->len > 0 && e->name[0] != '.' && e->name[strlen(e->name) - 1] != '~') {
+                add_changed(w, e->name);
+                w->last_event_ms = SDL_GetTicks();
+            }
+            p += sizeof(struct inotify_event) + e->len;
+        }
+    }
+
+    if (w->changed_count == 0 || SDL_GetTicks() - w->last_event_ms < DEBOUNCE_MS)
+        return 0;
+
+    /* The strings stay in changed[] until the next poll clears them */
+    int count = w->changed_count;
+    for (int i = 0; i < count; i++)
+        w->reported[i] = w->changed[i];
+    w->changed_count = 0;
+    *paths = w->reported;
+    return count;
+}
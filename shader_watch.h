@@ -0,0 +1,16 @@
+#pragma once
+
+typedef struct shader_watch shader_watch;
+
+/* Watch the files in dir (e.g. "shaders") for saves, with inotify. Returns
+   NULL if the directory cannot be watched. */
+shader_watch *shader_watch_create(const char *dir);
+
+void shader_watch_destroy(shader_watch *w);
+
+/* Collect file events without blocking. Once a changed file has seen no
+   further writes for a short debounce interval, returns how many files
+   changed and sets *paths to them as "dir/name" (valid until the next
+   call); otherwise returns 0. Editors that save in several writes, or by
+   writing a temporary file and renaming it, yield one report per file. */
+int shader_watch_poll(shader_watch *w, const char *const **paths);
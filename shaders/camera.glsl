@@ -0,0 +1,16 @@
+/* Primary rays, shared by the raymarcher and the cone pre-pass */
+
+#include "frame_data.glsl"
+
+/* Per 8x8 tile, a distance no pixel ray of the tile hits anything before;
+   written by cone.comp, read by raymarch.comp */
+#define CONE_TILE 8
+
+/* Primary ray direction through a pixel position of this dispatch
+   (centres at +0.5), offset by the tile origin into the whole image */
+vec3 camera_ray(vec2 pixel)
+{
+    vec2 uv = 2.0 * (pixel + vec2(u_tile_origin)) / u_image_size - 1.0;
+    uv.x *= u_image_size.x / u_image_size.y;
+    return normalize(uv.x * u_camera_right + uv.y * u_camera_up + u_camera_forward);
+}
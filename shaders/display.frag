@@ -5,8 +5,34 @@ in vec2 v_uv;
 out vec4 frag_color;
 
 uniform sampler2D u_image;
+uniform vec2 u_uv_scale;   /* rendered fraction of u_image */
+uniform vec2 u_uv_max;     /* half a texel inside the rendered area */
+
+/* Cost heatmap instead of the image: u_cost_view 1-3 shows channel 0-2 of
+   u_cost (march steps, shadow steps, AO samples), 4 their sum, scaled so
+   u_cost_max is the hot end */
+uniform usampler2D u_cost;
+uniform int u_cost_view;
+uniform float u_cost_max;
+
+/* Blue through cyan, green and yellow to red */
+vec3 heat(float t)
+{
+    t = clamp(t, 0.0, 1.0);
+    return clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+}
 
 void main()
 {
-    frag_color = texture(u_image, v_uv);
+    vec2 uv = min(v_uv * u_uv_scale, u_uv_max);
+    if (u_cost_view == 0)
+    {
+        frag_color = texture(u_image, uv);
+        return;
+    }
+    /* Integer textures are not filtered: show the nearest pixel's cost */
+    uvec4 cost = texelFetch(u_cost, ivec2(uv * vec2(textureSize(u_cost, 0))), 0);
+    uint value = u_cost_view == 1 ? cost.r : u_cost_view == 2 ? cost.g : u_cost_view == 3 ? cost.b
+                                                                           : cost.r + cost.g + cost.b;
+    frag_color = vec4(heat(float(value) / u_cost_max), 1.0);
 }
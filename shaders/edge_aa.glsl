@@ -0,0 +1,36 @@
+/* Adaptive edge anti-aliasing, shared by raymarch.comp and edge.comp. The
+   raymarch stores each pixel's normal and hit object in u_edge_info;
+   edge.comp lists the pixels whose neighbours disagree in EdgePixels,
+   counting the workgroups needed as it goes; then a second, indirect
+   dispatch of raymarch.comp re-samples just those pixels. */
+
+#define EDGE_GROUP_SIZE 64      /* raymarch.comp's 8x8 workgroup, flattened */
+
+layout(std430, binding = 7) buffer EdgePixels {
+    uint edge_groups[3];        /* glDispatchComputeIndirect arguments */
+    uint edge_count;
+    uint edge_pixels[];         /* x | y << 16 */
+};
+
+/* A normal (octahedral, 8 bits per axis) and object + 1 (0 for a miss) in
+   one uint */
+uint pack_edge_info(vec3 n, int object)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return (packUnorm4x8(vec4(e * 0.5 + 0.5, 0.0, 0.0)) & 0xffffu) | (uint(object + 1) << 16);
+}
+
+uint edge_object(uint info)
+{
+    return info >> 16;
+}
+
+vec3 edge_normal(uint info)
+{
+    vec2 e = unpackUnorm4x8(info).xy * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
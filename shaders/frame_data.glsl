@@ -0,0 +1,31 @@
+/* Per-frame state; must match frame_data in gl_renderer.c */
+layout(std140, binding = 0) uniform FrameData {
+    vec2 u_resolution;
+    float u_time;
+    vec3 u_camera_pos;
+    vec3 u_camera_forward;
+    vec3 u_camera_right;
+    vec3 u_camera_up;
+    int u_object_count;
+    vec3 u_cache_origin;    /* distance cache: world position of cell (0,0,0) */
+    float u_cache_voxel;    /* sample spacing */
+    ivec3 u_cache_cells;    /* coarse grid size in bricks */
+    int u_cache_enabled;
+    int u_dynamic_count;    /* objects with SCENE_OBJECT_DYNAMIC */
+    int u_cone_prepass;     /* u_tile_start was written for this frame */
+    vec2 u_prev_resolution; /* previous frame, for temporal reprojection */
+    vec3 u_prev_camera_pos;
+    int u_reproject;        /* u_prev_depth holds a usable previous frame */
+    vec3 u_prev_camera_forward;
+    vec3 u_prev_camera_right;
+    vec3 u_prev_camera_up;
+    int u_normal_mode;      /* NORMALS_* */
+    int u_march_mode;       /* MARCH_RELAXED | MARCH_FOOTPRINT */
+    int u_cost_view;        /* u_cost and the step histogram are written */
+    ivec2 u_tile_origin;    /* this dispatch covers u_resolution pixels from here */
+    vec2 u_image_size;      /* of the whole image; u_resolution unless tiled */
+    vec2 u_jitter;          /* primary ray position inside the pixel; 0.5 is the centre */
+    int u_accumulate;       /* add this frame to u_accum as sample u_sample_index */
+    int u_sample_index;
+    int u_edge_aa;          /* edge.comp and the re-sampling pass run this frame */
+};
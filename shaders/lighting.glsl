@@ -0,0 +1,113 @@
+/* Shading terms at a surface point: normals, soft shadows and ambient
+   occlusion, all evaluated on the scene distance. */
+
+#include "scene.glsl"
+
+/* Shadow and AO settings; gl_renderer builds quality variants that
+   override them (ENABLE_* 0 leaves the term out entirely) */
+#ifndef ENABLE_SHADOWS
+#define ENABLE_SHADOWS 1
+#endif
+#ifndef SHADOW_MAX_STEPS
+#define SHADOW_MAX_STEPS 64
+#endif
+#ifndef SHADOW_K
+#define SHADOW_K 32.0           /* penumbra sharpness */
+#endif
+#ifndef ENABLE_AO
+#define ENABLE_AO 1
+#endif
+#ifndef AO_SAMPLES
+#define AO_SAMPLES 5
+#endif
+
+vec3 lambert(vec3 pos, vec3 normal, vec3 light_pos, vec3 base_color)
+{
+    vec3 d = normalize(light_pos - pos);
+    float intensity = max(0.0, dot(d, normal));
+    return intensity * base_color;
+}
+
+/* Normal strategies (u_normal_mode; gl_renderer_normals in gl_renderer.h) */
+#define NORMALS_CENTRAL 0       /* central differences: six scene_sdf taps */
+#define NORMALS_TETRAHEDRAL 1   /* four taps on the corners of a tetrahedron */
+#define NORMALS_ANALYTIC 2      /* one BVH traversal (every object within reach), then the
+                                   nearest object on dual numbers */
+
+vec3 calc_normal_tetrahedral(vec3 p)
+{
+    const float eps = 0.0001;
+    const vec2 k = vec2(1.0, -1.0);
+    return normalize(k.xyy * scene_sdf(p + k.xyy * eps) + k.yyx * scene_sdf(p + k.yyx * eps) +
+                     k.yxy * scene_sdf(p + k.yxy * eps) + k.xxx * scene_sdf(p + k.xxx * eps));
+}
+
+vec3 calc_normal(vec3 p)
+{
+    if (u_normal_mode == NORMALS_TETRAHEDRAL)
+        return calc_normal_tetrahedral(p);
+    if (u_normal_mode == NORMALS_ANALYTIC)
+    {
+        int nearest;
+        scene_sdf_bvh(p, 1e10, SDF_ALL, nearest);
+        if (nearest < 0)
+            return calc_normal_tetrahedral(p);
+        return normalize(eval_object_gradient(objects[nearest], p).yzw);
+    }
+
+    const float eps = 0.0001;
+    vec3 n;
+    n.x = scene_sdf(p + vec3(eps, 0.0, 0.0)) - scene_sdf(p - vec3(eps, 0.0, 0.0));
+    n.y = scene_sdf(p + vec3(0.0, eps, 0.0)) - scene_sdf(p - vec3(0.0, eps, 0.0));
+    n.z = scene_sdf(p + vec3(0.0, 0.0, eps)) - scene_sdf(p - vec3(0.0, 0.0, eps));
+    return normalize(n);
+}
+
+/* Ambient occlusion: sample SDF along normal to estimate how much geometry blocks ambient light.
+   The samples always span 0.01 to 0.09 with the same falloff, so fewer of
+   them give a coarser estimate of the same quantity. */
+float calc_ao(vec3 pos, vec3 normal)
+{
+    const float spacing = 0.08 / float(max(AO_SAMPLES - 1, 1));
+    const float falloff = pow(0.75, 4.0 / float(max(AO_SAMPLES - 1, 1)));
+
+    float occ = 0.0;
+    float scale = 1.0;
+    for (int i = 0; i < AO_SAMPLES; i++)
+    {
+        float hr = 0.01 + spacing * float(i);
+        vec3 aopos = pos + normal * hr;
+        float d = scene_sdf(aopos);
+        occ += (hr - d) * scale;
+        scale *= falloff;
+    }
+    return 1.0 - clamp(occ * 5.0 / float(AO_SAMPLES), 0.0, 1.0);
+}
+
+/* steps receives the scene evaluations taken, for the cost statistics */
+float shadow_ray(vec3 origin, vec3 dir, float max_dist, out int steps)
+{
+    const float threshold = 0.001;
+
+    float dist = 0.0;
+    float soft = 1.0;
+
+    for (steps = 0; steps < SHADOW_MAX_STEPS; steps++)
+    {
+        if (dist >= max_dist)
+            return soft;
+
+        vec3 p = origin + dist * dir;
+        float d = scene_sdf_march(p);
+
+        if (d < threshold)
+        {
+            steps++;
+            return 0.0;
+        }
+
+        soft = min(soft, SHADOW_K * d / max(dist, 0.001));
+        dist += d;
+    }
+    return soft;
+}
@@ -0,0 +1,68 @@
+/* Per-frame raymarch statistics, summed over the whole dispatch into the
+   slot of the MarchStats ring gl_renderer bound for this frame (see
+   march_stats in gl_renderer.c). Each workgroup adds into shared memory
+   first, so the buffer sees one atomic per workgroup and counter rather
+   than one per pixel. stats_begin and stats_end contain barriers: call
+   them from uniform control flow. */
+
+/* Pixels by primary march steps, STATS_BIN_STEPS per bin with the last
+   bin open-ended; only gathered while a cost view is on (u_cost_view).
+   Must match GL_RENDERER_COST_BINS and GL_RENDERER_COST_BIN_STEPS. */
+#define STATS_BINS 32
+#define STATS_BIN_STEPS 8
+
+layout(std430, binding = 5) buffer MarchStats {
+    uint stat_march_steps;      /* primary ray scene evaluations */
+    uint stat_shadow_steps;     /* shadow ray scene evaluations */
+    uint stat_ao_samples;
+    uint stat_edge_pixels;      /* copied in by gl_renderer after edge detection */
+    uint stat_edge_steps;       /* scene evaluations of edge re-sample rays */
+    uint stat_histogram[STATS_BINS];
+};
+
+shared uint s_cost[4];
+shared uint s_histogram[STATS_BINS];
+
+void stats_begin()
+{
+    uint i = gl_LocalInvocationIndex;
+    if (i < 4u)
+        s_cost[i] = 0u;
+    if (i < uint(STATS_BINS))
+        s_histogram[i] = 0u;
+    barrier();
+}
+
+/* One pixel's march steps, shadow steps and AO samples */
+void stats_add(uvec3 cost)
+{
+    atomicAdd(s_cost[0], cost.x);
+    atomicAdd(s_cost[1], cost.y);
+    atomicAdd(s_cost[2], cost.z);
+    if (u_cost_view != 0)
+        atomicAdd(s_histogram[min(cost.x / uint(STATS_BIN_STEPS), uint(STATS_BINS - 1))], 1u);
+}
+
+/* Costs of edge re-sample rays: every march step, shadow step and AO
+   sample is one scene evaluation, counted apart from the primary rays so
+   their figures do not change with edge anti-aliasing */
+void stats_add_edge(uvec3 cost)
+{
+    atomicAdd(s_cost[3], cost.x + cost.y + cost.z);
+}
+
+void stats_end()
+{
+    barrier();
+    uint i = gl_LocalInvocationIndex;
+    if (i == 0u)
+        atomicAdd(stat_march_steps, s_cost[0]);
+    else if (i == 1u)
+        atomicAdd(stat_shadow_steps, s_cost[1]);
+    else if (i == 2u)
+        atomicAdd(stat_ao_samples, s_cost[2]);
+    else if (i == 3u)
+        atomicAdd(stat_edge_steps, s_cost[3]);
+    if (u_cost_view != 0 && i < uint(STATS_BINS) && s_histogram[i] != 0u)
+        atomicAdd(stat_histogram[i], s_histogram[i]);
+}
@@ -0,0 +1,435 @@
+/* The scene as uploaded by gl_renderer_set_scene, and its distance
+   function: interpreter, BVH culling and the static distance cache.
+   Shared by every compute kernel. */
+
+#include "frame_data.glsl"
+#include "sdf.glsl"
+
+/* ---- Scene interpreter ----
+   The scene is uploaded by gl_renderer_set_scene (see scene.h for the
+   layout, which must match these structs). Each object walks its model's
+   node list, folding every primitive into a running distance with the
+   node's operator; a grouped run is folded separately and then joined.
+   Objects are combined with a hard union. */
+
+#define SCENE_PRIM_SPHERE 0u
+#define SCENE_PRIM_BOX 1u
+#define SCENE_PRIM_CAPPED_CONE 2u
+#define SCENE_PRIM_TORUS 3u
+#define SCENE_OP_UNION 0u
+#define SCENE_OP_SUBTRACTION 1u
+#define SCENE_OP_INTERSECTION 2u
+#define SCENE_OP_SMOOTH_UNION 3u
+#define SCENE_OP_SMOOTH_SUBTRACTION 4u
+#define SCENE_NODE_GROUP_BEGIN (1u << 16)
+#define SCENE_NODE_GROUP_END (1u << 17)
+
+struct SceneNode {
+    vec4 offset_k;    /* xyz: primitive centre in model space, w: smoothing k */
+    vec4 params;
+    vec2 rot;         /* cos, sin of the inverse rotation about Y */
+    uint type_op;
+    uint material;
+};
+
+struct SceneObject {
+    vec4 xform[3];    /* world-to-model rows */
+    uint first_node;
+    uint node_count;
+    float scale;
+    uint flags;
+};
+
+#define SCENE_OBJECT_DYNAMIC 1u
+
+/* gl_renderer.c defines the table size to fit GL_MAX_UNIFORM_BLOCK_SIZE */
+#ifndef SCENE_MAX_NODES
+#define SCENE_MAX_NODES 1024
+#endif
+
+layout(std140, binding = 1) uniform SceneNodes { SceneNode nodes[SCENE_MAX_NODES]; };
+layout(std430, binding = 2) readonly buffer SceneObjects { SceneObject objects[]; };
+layout(std430, binding = 3) readonly buffer SceneMaterials { vec4 materials[]; };
+
+/* Object bounds hierarchy (scene_bvh in scene.c). Leaves hold one object;
+   an interior node's left child is the next node. */
+struct SceneBVHNode {
+    vec3 centre;
+    uint right;
+    vec3 extent;
+    int object;
+};
+
+layout(std430, binding = 4) readonly buffer SceneBVH { SceneBVHNode bvh[]; };
+
+#define BVH_STACK_SIZE 32   /* SCENE_BVH_MAX_DEPTH: scene_bvh refuses deeper trees */
+#define BVH_BOUND_MARGIN 1.0
+
+float prim_distance(uint type, vec3 p, vec4 params)
+{
+    if (type == SCENE_PRIM_SPHERE)
+        return sdf_sphere(p, params.x);
+    if (type == SCENE_PRIM_BOX)
+        return sdf_box(p, params.xyz);
+    if (type == SCENE_PRIM_CAPPED_CONE)
+        return sdf_capped_cone(p, params.x, params.y, params.z);
+    return sdf_torus(p, params.xy);
+}
+
+vec4 prim_gradient(uint type, vec3 p, vec4 params)
+{
+    if (type == SCENE_PRIM_SPHERE)
+        return sdg_sphere(p, params.x);
+    if (type == SCENE_PRIM_BOX)
+        return sdg_box(p, params.xyz);
+    if (type == SCENE_PRIM_CAPPED_CONE)
+        return sdg_capped_cone(p, params.x, params.y, params.z);
+    return sdg_torus(p, params.xy);
+}
+
+/* All five operators as one smooth minimum with sign flips, so each node
+   runs a single straight-line blend instead of a branch per operator:
+   union min(a, b), subtraction -min(-a, b), intersection -min(-a, -b), and
+   the smooth variants with k > 0. Colours follow the SDFHit ops above. */
+SDFHit apply_op(uint op, SDFHit a, SDFHit b, float k)
+{
+    bool flip_a = op == SCENE_OP_SUBTRACTION || op == SCENE_OP_INTERSECTION ||
+                  op == SCENE_OP_SMOOTH_SUBTRACTION;
+    bool flip_b = op == SCENE_OP_INTERSECTION;
+    float sa = flip_a ? -1.0 : 1.0;
+    float x = sa * a.d;
+    float y = flip_b ? -b.d : b.d;
+    float k4 = op >= SCENE_OP_SMOOTH_UNION ? k * 4.0 : 0.0;
+    float inv_k4 = 1.0 / max(k4, 1e-20);
+
+    float h = max(k4 - abs(x - y), 0.0);
+    float d = min(x, y) - h * h * 0.25 * inv_k4;
+    float t = clamp(0.5 + 0.5 * (y - x) * inv_k4, 0.0, 1.0);
+    vec3 col = flip_a ? (flip_b ? b.color : a.color) : mix(a.color, b.color, 1.0 - t);
+    return SDFHit(sa * d, col);
+}
+
+/* apply_op's distance alone, for the march loops: no colour is carried
+   or blended */
+float apply_op_distance(uint op, float a, float b, float k)
+{
+    bool flip_a = op == SCENE_OP_SUBTRACTION || op == SCENE_OP_INTERSECTION ||
+                  op == SCENE_OP_SMOOTH_SUBTRACTION;
+    float sa = flip_a ? -1.0 : 1.0;
+    float x = sa * a;
+    float y = op == SCENE_OP_INTERSECTION ? -b : b;
+    float k4 = op >= SCENE_OP_SMOOTH_UNION ? k * 4.0 : 0.0;
+    float inv_k4 = 1.0 / max(k4, 1e-20);
+
+    float h = max(k4 - abs(x - y), 0.0);
+    return sa * (min(x, y) - h * h * 0.25 * inv_k4);
+}
+
+/* apply_op on dual numbers (see opSmoothUnion above for the gradient) */
+vec4 apply_op_gradient(uint op, vec4 a, vec4 b, float k)
+{
+    bool flip_a = op == SCENE_OP_SUBTRACTION || op == SCENE_OP_INTERSECTION ||
+                  op == SCENE_OP_SMOOTH_SUBTRACTION;
+    float sa = flip_a ? -1.0 : 1.0;
+    float sb = op == SCENE_OP_INTERSECTION ? -1.0 : 1.0;
+    float k4 = op >= SCENE_OP_SMOOTH_UNION ? k * 4.0 : 0.0;
+    float inv_k4 = 1.0 / max(k4, 1e-20);
+    vec4 x = sa * a, y = sb * b;
+
+    float h = max(k4 - abs(x.x - y.x), 0.0);
+    float d = min(x.x, y.x) - h * h * 0.25 * inv_k4;
+    float t = clamp(0.5 + 0.5 * (y.x - x.x) * inv_k4, 0.0, 1.0);
+    return sa * vec4(d, mix(y.yzw, x.yzw, t));
+}
+
+/* eval_object's distance alone */
+float eval_object_distance(SceneObject obj, vec3 pos)
+{
+    vec4 wp = vec4(pos, 1.0);
+    vec3 p = vec3(dot(obj.xform[0], wp), dot(obj.xform[1], wp), dot(obj.xform[2], wp));
+
+    float acc = 1e10;
+    float group = acc;
+    bool in_group = false;
+    uint join_op = SCENE_OP_UNION;
+    float join_k = 0.0;
+
+    uint end = obj.first_node + obj.node_count;
+    for (uint i = obj.first_node; i < end; i++)
+    {
+        SceneNode n = nodes[i];
+        vec3 q = p - n.offset_k.xyz;
+        q = vec3(q.x * n.rot.x + q.z * n.rot.y, q.y, -q.x * n.rot.y + q.z * n.rot.x);
+        float h = prim_distance(n.type_op & 0xffu, q, n.params);
+        uint op = (n.type_op >> 8) & 0xffu;
+
+        if ((n.type_op & SCENE_NODE_GROUP_BEGIN) != 0u)
+        {
+            group = h;
+            join_op = op;
+            join_k = n.offset_k.w;
+            in_group = true;
+        }
+        else if (in_group)
+            group = apply_op_distance(op, group, h, n.offset_k.w);
+        else
+            acc = apply_op_distance(op, acc, h, n.offset_k.w);
+
+        if ((n.type_op & SCENE_NODE_GROUP_END) != 0u)
+        {
+            acc = apply_op_distance(join_op, acc, group, join_k);
+            in_group = false;
+        }
+    }
+    return acc * obj.scale;
+}
+
+/* Distance and blended material colour of one object. Only the material
+   resolve at a hit needs the colour; everything else uses
+   eval_object_distance. */
+SDFHit eval_object(SceneObject obj, vec3 pos)
+{
+    vec4 wp = vec4(pos, 1.0);
+    vec3 p = vec3(dot(obj.xform[0], wp), dot(obj.xform[1], wp), dot(obj.xform[2], wp));
+
+    SDFHit acc = SDFHit(1e10, vec3(1.0));
+    SDFHit group = acc;
+    bool in_group = false;
+    uint join_op = SCENE_OP_UNION;
+    float join_k = 0.0;
+
+    uint end = obj.first_node + obj.node_count;
+    for (uint i = obj.first_node; i < end; i++)
+    {
+        SceneNode n = nodes[i];
+        vec3 q = p - n.offset_k.xyz;
+        q = vec3(q.x * n.rot.x + q.z * n.rot.y, q.y, -q.x * n.rot.y + q.z * n.rot.x);
+        SDFHit h = SDFHit(prim_distance(n.type_op & 0xffu, q, n.params), materials[n.material].rgb);
+        uint op = (n.type_op >> 8) & 0xffu;
+
+        if ((n.type_op & SCENE_NODE_GROUP_BEGIN) != 0u)
+        {
+            group = h;
+            join_op = op;
+            join_k = n.offset_k.w;
+            in_group = true;
+        }
+        else if (in_group)
+            group = apply_op(op, group, h, n.offset_k.w);
+        else
+            acc = apply_op(op, acc, h, n.offset_k.w);
+
+        if ((n.type_op & SCENE_NODE_GROUP_END) != 0u)
+        {
+            acc = apply_op(join_op, acc, group, join_k);
+            in_group = false;
+        }
+    }
+    return SDFHit(acc.d * obj.scale, acc.color);
+}
+
+/* eval_object's distance and world-space gradient in one pass: the node
+   walk on dual numbers, with each node rotation and the object transform
+   applied to the gradient by the chain rule (transposed) */
+vec4 eval_object_gradient(SceneObject obj, vec3 pos)
+{
+    vec4 wp = vec4(pos, 1.0);
+    vec3 p = vec3(dot(obj.xform[0], wp), dot(obj.xform[1], wp), dot(obj.xform[2], wp));
+
+    vec4 acc = vec4(1e10, 0.0, 1.0, 0.0);
+    vec4 group = acc;
+    bool in_group = false;
+    uint join_op = SCENE_OP_UNION;
+    float join_k = 0.0;
+
+    uint end = obj.first_node + obj.node_count;
+    for (uint i = obj.first_node; i < end; i++)
+    {
+        SceneNode n = nodes[i];
+        vec3 q = p - n.offset_k.xyz;
+        q = vec3(q.x * n.rot.x + q.z * n.rot.y, q.y, -q.x * n.rot.y + q.z * n.rot.x);
+        vec4 h = prim_gradient(n.type_op & 0xffu, q, n.params);
+        h.yzw = vec3(h.y * n.rot.x - h.w * n.rot.y, h.z, h.y * n.rot.y + h.w * n.rot.x);
+        uint op = (n.type_op >> 8) & 0xffu;
+
+        if ((n.type_op & SCENE_NODE_GROUP_BEGIN) != 0u)
+        {
+            group = h;
+            join_op = op;
+            join_k = n.offset_k.w;
+            in_group = true;
+        }
+        else if (in_group)
+            group = apply_op_gradient(op, group, h, n.offset_k.w);
+        else
+            acc = apply_op_gradient(op, acc, h, n.offset_k.w);
+
+        if ((n.type_op & SCENE_NODE_GROUP_END) != 0u)
+        {
+            acc = apply_op_gradient(join_op, acc, group, join_k);
+            in_group = false;
+        }
+    }
+    vec3 g = acc.y * obj.xform[0].xyz + acc.z * obj.xform[1].xyz + acc.w * obj.xform[2].xyz;
+    return vec4(acc.x, g) * obj.scale;
+}
+
+/* Which objects scene_sdf_bvh considers */
+#define SDF_ALL 0
+#define SDF_STATIC 1
+#define SDF_DYNAMIC 2
+
+/* Hard union of the distances of the objects selected by subset, folded
+   into res (so a known bound culls from the start). nearest receives the
+   object that supplied the result, or -1. The BVH is
+   walked nearest child first. An object's distance is never below the
+   signed distance to its box, so a subtree whose box is no nearer than the
+   closest surface found so far cannot change the minimum and is skipped.
+   A leaf more than BVH_BOUND_MARGIN away contributes its box distance
+   instead of being evaluated: still a safe step, and never the minimum
+   near a surface, where normals, AO and hits are decided. */
+float scene_sdf_bvh(vec3 pos, float res, int subset, out int nearest)
+{
+    nearest = -1;
+    if (u_object_count == 0)
+        return res;
+
+    uint stack[BVH_STACK_SIZE];
+    float stack_dist[BVH_STACK_SIZE];
+    int sp = 0;
+    uint node = 0u;
+    float node_dist = sdf_box(pos - bvh[0].centre, bvh[0].extent);
+
+    while (true)
+    {
+        if (node_dist < res)
+        {
+            SceneBVHNode n = bvh[node];
+            if (n.object >= 0)
+            {
+                bool dynamic = (objects[n.object].flags & SCENE_OBJECT_DYNAMIC) != 0u;
+                if (subset == SDF_ALL || dynamic == (subset == SDF_DYNAMIC))
+                {
+                    bool far = node_dist > BVH_BOUND_MARGIN;
+                    float h = far ? node_dist : eval_object_distance(objects[n.object], pos);
+                    if (h < res)
+                    {
+                        res = h;
+                        nearest = far ? -1 : n.object;
+                    }
+                }
+            }
+            else
+            {
+                uint left = node + 1u;
+                float dl = sdf_box(pos - bvh[left].centre, bvh[left].extent);
+                float dr = sdf_box(pos - bvh[n.right].centre, bvh[n.right].extent);
+                /* Descend into the nearer child, defer the other */
+                bool left_first = dl <= dr;
+                /* Never full: the tree is at most BVH_STACK_SIZE levels deep */
+                if (sp < BVH_STACK_SIZE)
+                {
+                    stack[sp] = left_first ? n.right : left;
+                    stack_dist[sp] = left_first ? dr : dl;
+                    sp++;
+                }
+                node = left_first ? left : n.right;
+                node_dist = left_first ? dl : dr;
+                continue;
+            }
+        }
+        if (sp == 0)
+            break;
+        sp--;
+        node = stack[sp];
+        node_dist = stack_dist[sp];
+    }
+    return res;
+}
+
+/* Scene SDF: hard union of every object */
+float scene_sdf(vec3 pos)
+{
+    int nearest;
+    return scene_sdf_bvh(pos, 1e10, SDF_ALL, nearest);
+}
+
+/* Colour of the surface at pos, which object (the nearest one a march
+   reported, not -1) is closest to. Objects meet in a hard union, so its
+   own material blend is the whole answer: the one colour evaluation per
+   pixel, reading the material table. */
+vec3 scene_color(int object, vec3 pos)
+{
+    return object >= 0 ? eval_object(objects[object], pos).color : vec3(1.0);
+}
+
+/* ---- Distance cache ----
+   Static objects are baked by gl_renderer.c into a sparse grid of bricks.
+   The coarse texture holds one texel per brick: y >= 0 is the brick's slot
+   in the atlas, otherwise x is the distance at the (empty) brick's centre,
+   or negative when the brick is deep inside geometry. A distance field
+   changes no faster than the distance moved, so d(centre) - |p - centre|
+   bounds the distance at p.
+   An atlas brick is SDF_CACHE_BRICK^3 samples, shared with its neighbours
+   at the faces, holding distance only: colour is resolved from the exact
+   hit, so the cache never needs material IDs. */
+
+#define SDF_CACHE_BRICK 8
+#define SDF_CACHE_ATLAS_BRICKS 32   /* bricks per atlas row and column */
+
+/* Trilinear interpolation of a 1-Lipschitz field stays within half a
+   voxel diagonal of the true distance */
+#define SDF_CACHE_ERROR 0.8660254
+
+/* Below this, the cache hands over to exact evaluation */
+#define SDF_CACHE_EXACT_BAND 0.02
+
+layout(binding = 1) uniform sampler3D u_cache_atlas;
+layout(binding = 2) uniform sampler3D u_cache_coarse;
+
+/* Lower bound on the static scene's distance at pos, or a negative value
+   where the cache cannot tell (outside the volume, inside geometry). */
+float cache_distance(vec3 pos)
+{
+    vec3 g = (pos - u_cache_origin) / (u_cache_voxel * float(SDF_CACHE_BRICK - 1));
+    if (any(lessThan(g, vec3(0.0))) || any(greaterThanEqual(g, vec3(u_cache_cells))))
+        return -1.0;
+
+    ivec3 cell = ivec3(g);
+    vec2 coarse = texelFetch(u_cache_coarse, cell, 0).xy;
+    float brick_size = u_cache_voxel * float(SDF_CACHE_BRICK - 1);
+    if (coarse.y < 0.0)
+        return coarse.x - length(g - vec3(cell) - 0.5) * brick_size;
+
+    int slot = int(coarse.y);
+    ivec3 base = ivec3(slot % SDF_CACHE_ATLAS_BRICKS,
+                       (slot / SDF_CACHE_ATLAS_BRICKS) % SDF_CACHE_ATLAS_BRICKS,
+                       slot / (SDF_CACHE_ATLAS_BRICKS * SDF_CACHE_ATLAS_BRICKS)) * SDF_CACHE_BRICK;
+    vec3 local = (g - vec3(cell)) * float(SDF_CACHE_BRICK - 1);
+    vec3 uvw = (vec3(base) + 0.5 + local) / vec3(textureSize(u_cache_atlas, 0));
+    return texture(u_cache_atlas, uvw).x - SDF_CACHE_ERROR * u_cache_voxel;
+}
+
+/* Distance for sphere tracing. Where the cache bounds the static objects
+   away from their surfaces, only dynamic objects are evaluated, folded
+   into that bound; a dynamic surface within the band is still exact, as
+   static ones are at least the bound away. Near static surfaces (and
+   wherever the cache has no answer) it is the exact scene_sdf, so hits
+   and everything derived from them stay on the surfaces. nearest is the
+   object at the result for scene_color, -1 when the result is only a
+   bound, which must never be taken for a hit. */
+float scene_sdf_march(vec3 pos, out int nearest)
+{
+    float bound = u_cache_enabled != 0 ? cache_distance(pos) : -1.0;
+    bool cached = bound > SDF_CACHE_EXACT_BAND;
+    nearest = -1;
+    if (cached && u_dynamic_count == 0)
+        return bound;
+    return scene_sdf_bvh(pos, cached ? bound : 1e10, cached ? SDF_DYNAMIC : SDF_ALL, nearest);
+}
+
+float scene_sdf_march(vec3 pos)
+{
+    int nearest;
+    return scene_sdf_march(pos, nearest);
+}
@@ -0,0 +1,153 @@
+/* SDF library: primitives, their gradients and the combining operators.
+   Included by scene.glsl. */
+
+/* SDF result with material color for per-primitive coloring */
+struct SDFHit {
+    float d;
+    vec3 color;
+};
+
+/* ---- SDF Primitives (Straight from Inigo Quilez) ---- */
+
+float dot2(vec2 v) {return dot(v, v);}
+
+float sdf_sphere(vec3 p, float radius)
+{
+    return length(p) - radius;
+}
+
+float sdf_box(vec3 p, vec3 b)
+{
+    vec3 q = abs(p) - b;
+    return length(max(q,0.0)) + min(max(q.x,max(q.y,q.z)),0.0);
+}
+
+float sdf_capped_cone(vec3 p, float h, float r1, float r2)
+{
+    vec2 q = vec2( length(p.xz), p.y );
+    vec2 k1 = vec2(r2,h);
+    vec2 k2 = vec2(r2-r1,2.0*h);
+    vec2 ca = vec2(q.x-min(q.x,(q.y<0.0)?r1:r2), abs(q.y)-h);
+    vec2 cb = q - k1 + k2*clamp( dot(k1-q,k2)/dot2(k2), 0.0, 1.0 );
+    float s = (cb.x<0.0 && ca.y<0.0) ? -1.0 : 1.0;
+    return s*sqrt( min(dot2(ca),dot2(cb)) );
+}
+
+float sdf_torus( vec3 p, vec2 t )
+{
+  vec2 q = vec2(length(p.xz)-t.x,p.y);
+  return length(q)-t.y;
+}
+
+/* ---- SDF gradients ----
+   Forward-mode dual numbers: each function returns vec4(d, grad d), the
+   distance with its derivative along x, y and z carried through the same
+   arithmetic. Used for analytic normals, where one pass replaces the
+   finite-difference taps. Where a primitive is not differentiable (box
+   edges, cone rims) any of the one-sided gradients is returned. */
+
+vec4 sdg_sphere(vec3 p, float radius)
+{
+    float l = length(p);
+    return vec4(l - radius, p / max(l, 1e-8));
+}
+
+vec4 sdg_box(vec3 p, vec3 b)
+{
+    vec3 w = abs(p) - b;
+    vec3 s = vec3(p.x < 0.0 ? -1.0 : 1.0, p.y < 0.0 ? -1.0 : 1.0, p.z < 0.0 ? -1.0 : 1.0);
+    float g = max(w.x, max(w.y, w.z));
+    vec3 q = max(w, 0.0);
+    float l = length(q);
+    if (g > 0.0)
+        return vec4(l, s * q / l);
+    /* Inside: the nearest face's normal */
+    return vec4(g, s * (w.x == g ? vec3(1.0, 0.0, 0.0) : w.y == g ? vec3(0.0, 1.0, 0.0) : vec3(0.0, 0.0, 1.0)));
+}
+
+/* As sdf_capped_cone, differentiated in the (radius, height) half plane;
+   the chain rule through length(p.xz) spreads the radial part over x, z */
+vec4 sdg_capped_cone(vec3 p, float h, float r1, float r2)
+{
+    float radial = length(p.xz);
+    vec2 q = vec2(radial, p.y);
+    vec2 k1 = vec2(r2, h);
+    vec2 k2 = vec2(r2 - r1, 2.0 * h);
+    float cap_r = q.y < 0.0 ? r1 : r2;
+    vec2 ca = vec2(q.x - min(q.x, cap_r), abs(q.y) - h);
+    vec2 cb = q - k1 + k2 * clamp(dot(k1 - q, k2) / dot2(k2), 0.0, 1.0);
+    float s = (cb.x < 0.0 && ca.y < 0.0) ? -1.0 : 1.0;
+    /* d(ca)/dq is diagonal (1 past the rim, sign(q.y)); the offset to the
+       slanted side cb is perpendicular to it where unclamped, so its
+       derivative's projection drops out */
+    vec2 dca = vec2(ca.x, q.y < 0.0 ? -ca.y : ca.y);
+    float la = dot2(ca), lb = dot2(cb);
+    float l = sqrt(min(la, lb));
+    vec2 g = s * (la < lb ? dca : cb) / max(l, 1e-8);
+    vec2 dir = radial > 1e-8 ? p.xz / radial : vec2(0.0);
+    return vec4(s * l, g.x * dir.x, g.y, g.x * dir.y);
+}
+
+vec4 sdg_torus(vec3 p, vec2 t)
+{
+    float radial = length(p.xz);
+    vec2 q = vec2(radial - t.x, p.y);
+    float l = length(q);
+    vec2 g = q / max(l, 1e-8);
+    vec2 dir = radial > 1e-8 ? p.xz / radial : vec2(0.0);
+    return vec4(l - t.y, g.x * dir.x, g.y, g.x * dir.y);
+}
+
+/* opSmoothUnion on dual numbers. The blend factor's own derivative cancels
+   inside the blend region, so the gradient is the same mix of the inputs'
+   gradients as the value's weights. */
+vec4 opSmoothUnion(vec4 a, vec4 b, float k)
+{
+    k *= 4.0;
+    float h = max(k - abs(a.x - b.x), 0.0);
+    float d = min(a.x, b.x) - h*h*0.25/k;
+    float t = clamp(0.5 + 0.5*(b.x - a.x)/k, 0.0, 1.0);
+    return vec4(d, mix(b.yzw, a.yzw, t));
+}
+
+/* ---- SDF Operations (Also straight from Inigo Quilez) ---- */
+
+/* Rotate point around Y axis by angle (radians). To rotate an SDF, apply inverse
+   rotation to the sample point: sdf_box(rotate_y(pos - center, -angle), size) */
+vec3 rotate_y(vec3 p, float angle)
+{
+    float c = cos(angle), s = sin(angle);
+    return vec3(p.x * c + p.z * s, p.y, -p.x * s + p.z * c);
+}
+
+float opUnion( float a, float b ) { return min(a,b); }
+float opSubtraction( float a, float b ) { return max(-a,b); }
+float opIntersection( float a, float b ) { return max(a,b); }
+
+SDFHit opUnion(SDFHit a, SDFHit b) { return (a.d < b.d) ? a : b; }
+SDFHit opSubtraction(SDFHit a, SDFHit b) { return SDFHit(max(a.d, -b.d), a.color); }
+SDFHit opIntersection(SDFHit a, SDFHit b) { return SDFHit(max(a.d, b.d), b.color); }
+
+float opSmoothUnion( float a, float b, float k )
+{
+    k *= 4.0;
+    float h = max(k-abs(a-b),0.0);
+    return min(a, b) - h*h*0.25/k;
+}
+
+SDFHit opSmoothUnion(SDFHit a, SDFHit b, float k)
+{
+    k *= 4.0;
+    float h = max(k - abs(a.d - b.d), 0.0);
+    float d = min(a.d, b.d) - h*h*0.25/k;
+    float t = clamp(0.5 + 0.5*(b.d - a.d)/k, 0.0, 1.0);
+    vec3 col = mix(a.color, b.color, 1 - t);
+    return SDFHit(d, col);
+}
+
+SDFHit opSmoothSubtraction(SDFHit a, SDFHit b, float k)
+{
+    SDFHit neg_a = SDFHit(-a.d, a.color);
+    SDFHit u = opSmoothUnion(neg_a, b, k);
+    return SDFHit(-u.d, a.color);
+}